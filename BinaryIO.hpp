@@ -0,0 +1,68 @@
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Little helpers for the fixed-width binary records used by the command log.
+// Values are written in host byte order; the log is a local recovery file.
+
+inline void writeUInt8(std::ostream& out, uint8_t value) {
+    out.put(static_cast<char>(value));
+}
+
+inline void writeUInt32(std::ostream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void writeUInt64(std::ostream& out, uint64_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void writeInt32(std::ostream& out, int32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void writeDouble(std::ostream& out, double value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void writeString(std::ostream& out, const std::string& value) {
+    writeUInt32(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), value.size());
+}
+
+inline bool readUInt8(std::istream& in, uint8_t& value) {
+    char c;
+    if (!in.get(c)) return false;
+    value = static_cast<uint8_t>(c);
+    return true;
+}
+
+inline bool readUInt32(std::istream& in, uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool readUInt64(std::istream& in, uint64_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool readInt32(std::istream& in, int32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool readDouble(std::istream& in, double& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+inline bool readString(std::istream& in, std::string& value) {
+    uint32_t size;
+    if (!readUInt32(in, size)) return false;
+    value.resize(size);
+    return size == 0 || static_cast<bool>(in.read(&value[0], size));
+}
+
+#endif // BINARY_IO_HPP
@@ -1,5 +1,14 @@
 #include "Calculator.hpp"
 
+std::shared_ptr<TargetCalorieCalculator> TargetCalorieCalculator::createByName(const std::string& name) {
+    if (name == "Harris-Benedict Equation") {
+        return std::make_shared<HarrisBenedictCalculator>();
+    } else if (name == "Mifflin-St Jeor Equation") {
+        return std::make_shared<MifflinStJeorCalculator>();
+    }
+    return nullptr;
+}
+
 // Harris-Benedict calculator implementation
 double HarrisBenedictCalculator::calculateTargetCalories(Gender gender, double weightKg, double heightCm, int age, ActivityLevel activityLevel) const {
     double bmr;
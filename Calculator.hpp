@@ -3,6 +3,7 @@
 
 #include "common.hpp"
 #include <string>
+#include <memory>
 
 // Target Calorie Calculator - Strategy pattern
 class TargetCalorieCalculator {
@@ -10,6 +11,9 @@ public:
     virtual ~TargetCalorieCalculator() = default;
     virtual double calculateTargetCalories(Gender gender, double weightKg, double heightCm, int age, ActivityLevel activityLevel) const = 0;
     virtual std::string getName() const = 0;
+    
+    // Creates a calculator from its getName() value, nullptr if unknown
+    static std::shared_ptr<TargetCalorieCalculator> createByName(const std::string& name);
 };
 
 // Harris-Benedict formula
@@ -1,24 +1,60 @@
 #include "Command.hpp"
+#include "CommandLog.hpp"
+#include "BinaryIO.hpp"
+#include "Metrics.hpp"
+
+std::shared_ptr<Command> Command::deserialize(CommandType type, std::istream& in, CommandContext& context) {
+    switch (type) {
+        case CommandType::AddFood: return AddFoodCommand::deserialize(in, context);
+        case CommandType::RemoveFood: return RemoveFoodCommand::deserialize(in, context);
+        case CommandType::ChangeDate: return ChangeDateCommand::deserialize(in, context);
+        case CommandType::AddFoodToDb: return AddFoodToDbCommand::deserialize(in, context);
+        case CommandType::SetGender: return SetGenderCommand::deserialize(in, context);
+        case CommandType::SetHeight: return SetHeightCommand::deserialize(in, context);
+        case CommandType::SetAge: return SetAgeCommand::deserialize(in, context);
+        case CommandType::SetWeight: return SetWeightCommand::deserialize(in, context);
+        case CommandType::SetActivityLevel: return SetActivityLevelCommand::deserialize(in, context);
+        case CommandType::SetCalculator: return SetCalculatorCommand::deserialize(in, context);
+        case CommandType::RemoveFoodFromDb: return RemoveFoodFromDbCommand::deserialize(in, context);
+        case CommandType::UpdateFood: return UpdateFoodCommand::deserialize(in, context);
+    }
+    return nullptr;
+}
 
 // AddFoodCommand implementation
-AddFoodCommand::AddFoodCommand(DailyLog& l, std::shared_ptr<Food> f, double s)
-    : log(l), food(f), servings(s) {}
+AddFoodCommand::AddFoodCommand(DailyLog& l, const Food* f, double s, FoodUsageStats* u)
+    : log(l), date(l.getCurrentDate()), food(f), servings(s), usage(u) {}
+
+AddFoodCommand::AddFoodCommand(DailyLog& l, const std::string& d, const Food* f, double s, FoodUsageStats* u)
+    : log(l), date(d), food(f), servings(s), usage(u) {}
 
-void AddFoodCommand::execute() {
-    log.addFoodToCurrentDay(food, servings);
+bool AddFoodCommand::execute() {
+    log.addFoodToDay(date, food, servings);
+    if (usage) {
+        usage->recordUse(food->getIdentifier(), date);
+    }
+    return true;
 }
 
-void AddFoodCommand::undo() {
-    auto& dayLog = log.getCurrentDayLog();
-    const auto& entries = dayLog.getEntries();
-    
-    // Find the entry with this food and servings and remove it
-    for (int i = entries.size() - 1; i >= 0; --i) {
-        if (entries[i].food == food && entries[i].servings == servings) {
-            log.removeFoodFromCurrentDay(i);
-            break;
+bool AddFoodCommand::undo() {
+    const DayLog* dayLog = log.findDayLog(date);
+    if (dayLog) {
+        const auto& entries = dayLog->getEntries();
+        // Find the entry with this food and servings and remove it
+        for (int i = entries.size() - 1; i >= 0; --i) {
+            if (entries[i].food == food && entries[i].servings == servings) {
+                log.removeFoodFromDay(date, i);
+                if (usage) {
+                    // The serialized date, so a replayed undo of a command
+                    // executed before the snapshot reverts the right day too
+                    usage->revertUse(food->getIdentifier(), date);
+                }
+                return true;
+            }
         }
     }
+    failure = "the entry is no longer in the log for " + date;
+    return false;
 }
 
 std::string AddFoodCommand::toString() const {
@@ -27,16 +63,54 @@ std::string AddFoodCommand::toString() const {
     return ss.str();
 }
 
-// RemoveFoodCommand implementation
-RemoveFoodCommand::RemoveFoodCommand(DailyLog& l, int i)
-    : log(l), index(i), savedEntry(log.getCurrentDayLog().getEntries()[i]) {}
+CommandType AddFoodCommand::getType() const { return CommandType::AddFood; }
 
-void RemoveFoodCommand::execute() {
-    log.removeFoodFromCurrentDay(index);
+void AddFoodCommand::serialize(std::ostream& out) const {
+    writeString(out, date);
+    writeString(out, food->getReference());
+    writeDouble(out, servings);
 }
 
-void RemoveFoodCommand::undo() {
-    log.addFoodToCurrentDay(savedEntry.food, savedEntry.servings);
+std::shared_ptr<Command> AddFoodCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string date, foodId;
+    double servings;
+    if (!readString(in, date) || !readString(in, foodId) || !readDouble(in, servings)) return nullptr;
+    
+    auto food = context.foodDb->resolveReference(foodId);
+    if (!food) return nullptr;
+    return std::make_shared<AddFoodCommand>(context.log, date, food, servings, context.usage);
+}
+
+
+// RemoveFoodCommand implementation
+RemoveFoodCommand::RemoveFoodCommand(DailyLog& l, int i, FoodUsageStats* u)
+    : log(l), date(l.getCurrentDate()), index(i), savedEntry(log.getCurrentDayLog().getEntries()[i]), usage(u) {}
+
+RemoveFoodCommand::RemoveFoodCommand(DailyLog& l, const std::string& d, int i, const LogEntry& entry, FoodUsageStats* u)
+    : log(l), date(d), index(i), savedEntry(entry), usage(u) {}
+
+bool RemoveFoodCommand::execute() {
+    // The entry must still be where it was picked from
+    const DayLog* dayLog = log.findDayLog(date);
+    if (!dayLog || index < 0 || index >= static_cast<int>(dayLog->getEntries().size()) ||
+        dayLog->getEntries()[index].food != savedEntry.food ||
+        dayLog->getEntries()[index].servings != savedEntry.servings) {
+        failure = "entry " + std::to_string(index + 1) + " of " + date + " is not the one to remove";
+        return false;
+    }
+    log.removeFoodFromDay(date, index);
+    if (usage) {
+        usage->revertUse(savedEntry.food->getIdentifier(), date);
+    }
+    return true;
+}
+
+bool RemoveFoodCommand::undo() {
+    log.addFoodToDay(date, savedEntry.food, savedEntry.servings);
+    if (usage) {
+        usage->recordUse(savedEntry.food->getIdentifier(), date);
+    }
+    return true;
 }
 
 std::string RemoveFoodCommand::toString() const {
@@ -44,29 +118,77 @@ std::string RemoveFoodCommand::toString() const {
     ss << "Remove " << savedEntry.servings << " serving(s) of " << savedEntry.food->getIdentifier();
     return ss.str();
 }
+
+CommandType RemoveFoodCommand::getType() const { return CommandType::RemoveFood; }
+
+void RemoveFoodCommand::serialize(std::ostream& out) const {
+    writeString(out, date);
+    writeInt32(out, index);
+    writeString(out, savedEntry.food->getReference());
+    writeDouble(out, savedEntry.servings);
+}
+
+std::shared_ptr<Command> RemoveFoodCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string date;
+    int32_t index;
+    std::string foodId;
+    double servings;
+    if (!readString(in, date) || !readInt32(in, index) || !readString(in, foodId) || !readDouble(in, servings)) {
+        return nullptr;
+    }
+    
+    auto food = context.foodDb->resolveReference(foodId);
+    if (!food) return nullptr;
+    return std::make_shared<RemoveFoodCommand>(context.log, date, index, LogEntry(food, servings), context.usage);
+}
+
 SetGenderCommand::SetGenderCommand(DietProfile& p, Gender newG)
     : profile(p), oldGender(p.getGender()), newGender(newG) {}
 
-void SetGenderCommand::execute() {
+SetGenderCommand::SetGenderCommand(DietProfile& p, Gender oldG, Gender newG)
+    : profile(p), oldGender(oldG), newGender(newG) {}
+
+bool SetGenderCommand::execute() {
     profile.setGender(newGender);
+    return true;
 }
 
-void SetGenderCommand::undo() {
+bool SetGenderCommand::undo() {
     profile.setGender(oldGender);
+    return true;
 }
 
 std::string SetGenderCommand::toString() const {
     return "Change gender";
 }
+
+CommandType SetGenderCommand::getType() const { return CommandType::SetGender; }
+
+void SetGenderCommand::serialize(std::ostream& out) const {
+    writeUInt8(out, static_cast<uint8_t>(oldGender));
+    writeUInt8(out, static_cast<uint8_t>(newGender));
+}
+
+std::shared_ptr<Command> SetGenderCommand::deserialize(std::istream& in, CommandContext& context) {
+    uint8_t oldG, newG;
+    if (!readUInt8(in, oldG) || !readUInt8(in, newG)) return nullptr;
+    return std::make_shared<SetGenderCommand>(context.profile, static_cast<Gender>(oldG), static_cast<Gender>(newG));
+}
+
 SetHeightCommand::SetHeightCommand(DietProfile& p, double newH)
     : profile(p), oldHeight(p.getHeight()), newHeight(newH) {}
 
-void SetHeightCommand::execute() {
+SetHeightCommand::SetHeightCommand(DietProfile& p, double oldH, double newH)
+    : profile(p), oldHeight(oldH), newHeight(newH) {}
+
+bool SetHeightCommand::execute() {
     profile.setHeight(newHeight);
+    return true;
 }
 
-void SetHeightCommand::undo() {
+bool SetHeightCommand::undo() {
     profile.setHeight(oldHeight);
+    return true;
 }
 
 std::string SetHeightCommand::toString() const {
@@ -75,16 +197,35 @@ std::string SetHeightCommand::toString() const {
     return ss.str();
 }
 
+CommandType SetHeightCommand::getType() const { return CommandType::SetHeight; }
+
+void SetHeightCommand::serialize(std::ostream& out) const {
+    writeDouble(out, oldHeight);
+    writeDouble(out, newHeight);
+}
+
+std::shared_ptr<Command> SetHeightCommand::deserialize(std::istream& in, CommandContext& context) {
+    double oldH, newH;
+    if (!readDouble(in, oldH) || !readDouble(in, newH)) return nullptr;
+    return std::make_shared<SetHeightCommand>(context.profile, oldH, newH);
+}
+
+
 // SetAgeCommand implementation
 SetAgeCommand::SetAgeCommand(DietProfile& p, int newA)
     : profile(p), oldAge(p.getAge()), newAge(newA) {}
 
-void SetAgeCommand::execute() {
+SetAgeCommand::SetAgeCommand(DietProfile& p, int oldA, int newA)
+    : profile(p), oldAge(oldA), newAge(newA) {}
+
+bool SetAgeCommand::execute() {
     profile.setAge(newAge);
+    return true;
 }
 
-void SetAgeCommand::undo() {
+bool SetAgeCommand::undo() {
     profile.setAge(oldAge);
+    return true;
 }
 
 std::string SetAgeCommand::toString() const {
@@ -93,16 +234,35 @@ std::string SetAgeCommand::toString() const {
     return ss.str();
 }
 
+CommandType SetAgeCommand::getType() const { return CommandType::SetAge; }
+
+void SetAgeCommand::serialize(std::ostream& out) const {
+    writeInt32(out, oldAge);
+    writeInt32(out, newAge);
+}
+
+std::shared_ptr<Command> SetAgeCommand::deserialize(std::istream& in, CommandContext& context) {
+    int32_t oldA, newA;
+    if (!readInt32(in, oldA) || !readInt32(in, newA)) return nullptr;
+    return std::make_shared<SetAgeCommand>(context.profile, oldA, newA);
+}
+
+
 // SetWeightCommand implementation
 SetWeightCommand::SetWeightCommand(DietProfile& p, const std::string& d, double newW)
     : profile(p), date(d), oldWeight(p.getWeight(d)), newWeight(newW) {}
 
-void SetWeightCommand::execute() {
+SetWeightCommand::SetWeightCommand(DietProfile& p, const std::string& d, double oldW, double newW)
+    : profile(p), date(d), oldWeight(oldW), newWeight(newW) {}
+
+bool SetWeightCommand::execute() {
     profile.setWeight(date, newWeight);
+    return true;
 }
 
-void SetWeightCommand::undo() {
+bool SetWeightCommand::undo() {
     profile.setWeight(date, oldWeight);
+    return true;
 }
 
 std::string SetWeightCommand::toString() const {
@@ -111,16 +271,37 @@ std::string SetWeightCommand::toString() const {
     return ss.str();
 }
 
+CommandType SetWeightCommand::getType() const { return CommandType::SetWeight; }
+
+void SetWeightCommand::serialize(std::ostream& out) const {
+    writeString(out, date);
+    writeDouble(out, oldWeight);
+    writeDouble(out, newWeight);
+}
+
+std::shared_ptr<Command> SetWeightCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string date;
+    double oldW, newW;
+    if (!readString(in, date) || !readDouble(in, oldW) || !readDouble(in, newW)) return nullptr;
+    return std::make_shared<SetWeightCommand>(context.profile, date, oldW, newW);
+}
+
+
 // SetActivityLevelCommand implementation
 SetActivityLevelCommand::SetActivityLevelCommand(DietProfile& p, const std::string& d, ActivityLevel newL)
     : profile(p), date(d), oldLevel(p.getActivityLevel(d)), newLevel(newL) {}
 
-void SetActivityLevelCommand::execute() {
+SetActivityLevelCommand::SetActivityLevelCommand(DietProfile& p, const std::string& d, ActivityLevel oldL, ActivityLevel newL)
+    : profile(p), date(d), oldLevel(oldL), newLevel(newL) {}
+
+bool SetActivityLevelCommand::execute() {
     profile.setActivityLevel(date, newLevel);
+    return true;
 }
 
-void SetActivityLevelCommand::undo() {
+bool SetActivityLevelCommand::undo() {
     profile.setActivityLevel(date, oldLevel);
+    return true;
 }
 
 std::string SetActivityLevelCommand::toString() const {
@@ -129,31 +310,77 @@ std::string SetActivityLevelCommand::toString() const {
     return ss.str();
 }
 
+CommandType SetActivityLevelCommand::getType() const { return CommandType::SetActivityLevel; }
+
+void SetActivityLevelCommand::serialize(std::ostream& out) const {
+    writeString(out, date);
+    writeUInt8(out, static_cast<uint8_t>(oldLevel));
+    writeUInt8(out, static_cast<uint8_t>(newLevel));
+}
+
+std::shared_ptr<Command> SetActivityLevelCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string date;
+    uint8_t oldL, newL;
+    if (!readString(in, date) || !readUInt8(in, oldL) || !readUInt8(in, newL)) return nullptr;
+    return std::make_shared<SetActivityLevelCommand>(context.profile, date,
+        static_cast<ActivityLevel>(oldL), static_cast<ActivityLevel>(newL));
+}
+
+
 // SetCalculatorCommand implementation
 SetCalculatorCommand::SetCalculatorCommand(DietProfile& p, std::shared_ptr<TargetCalorieCalculator> newCalc)
     : profile(p), oldCalculator(p.getCalculator()), newCalculator(newCalc) {}
 
-void SetCalculatorCommand::execute() {
+SetCalculatorCommand::SetCalculatorCommand(DietProfile& p, std::shared_ptr<TargetCalorieCalculator> oldCalc,
+                                           std::shared_ptr<TargetCalorieCalculator> newCalc)
+    : profile(p), oldCalculator(oldCalc), newCalculator(newCalc) {}
+
+bool SetCalculatorCommand::execute() {
     profile.setCalculator(newCalculator);
+    return true;
 }
 
-void SetCalculatorCommand::undo() {
+bool SetCalculatorCommand::undo() {
     profile.setCalculator(oldCalculator);
+    return true;
 }
 
 std::string SetCalculatorCommand::toString() const {
     return "Change calorie calculator";
 }
+
+CommandType SetCalculatorCommand::getType() const { return CommandType::SetCalculator; }
+
+void SetCalculatorCommand::serialize(std::ostream& out) const {
+    writeString(out, oldCalculator->getName());
+    writeString(out, newCalculator->getName());
+}
+
+std::shared_ptr<Command> SetCalculatorCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string oldName, newName;
+    if (!readString(in, oldName) || !readString(in, newName)) return nullptr;
+    
+    auto oldCalc = TargetCalorieCalculator::createByName(oldName);
+    auto newCalc = TargetCalorieCalculator::createByName(newName);
+    if (!oldCalc || !newCalc) return nullptr;
+    return std::make_shared<SetCalculatorCommand>(context.profile, oldCalc, newCalc);
+}
+
 // ChangeDateCommand implementation
 ChangeDateCommand::ChangeDateCommand(DailyLog& l, const std::string& newD)
     : log(l), oldDate(l.getCurrentDate()), newDate(newD) {}
 
-void ChangeDateCommand::execute() {
+ChangeDateCommand::ChangeDateCommand(DailyLog& l, const std::string& oldD, const std::string& newD)
+    : log(l), oldDate(oldD), newDate(newD) {}
+
+bool ChangeDateCommand::execute() {
     log.setCurrentDate(newDate);
+    return true;
 }
 
-void ChangeDateCommand::undo() {
+bool ChangeDateCommand::undo() {
     log.setCurrentDate(oldDate);
+    return true;
 }
 
 std::string ChangeDateCommand::toString() const {
@@ -162,11 +389,37 @@ std::string ChangeDateCommand::toString() const {
     return ss.str();
 }
 
+CommandType ChangeDateCommand::getType() const { return CommandType::ChangeDate; }
+
+void ChangeDateCommand::serialize(std::ostream& out) const {
+    writeString(out, oldDate);
+    writeString(out, newDate);
+}
+
+std::shared_ptr<Command> ChangeDateCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string oldD, newD;
+    if (!readString(in, oldD) || !readString(in, newD)) return nullptr;
+    return std::make_shared<ChangeDateCommand>(context.log, oldD, newD);
+}
+
+
 // UndoManager implementation
+UndoManager::UndoManager() : commandLog(nullptr) {}
+
+void UndoManager::setCommandLog(CommandLog* log) {
+    commandLog = log;
+}
+
 bool UndoManager::executeCommand(std::shared_ptr<Command> command) {
-    command->execute();
+    YADA_TIME_SCOPE(CommandExecute);
+    if (!command->execute()) {
+        return false;
+    }
     undoStack.push(command);
-    std::cout << "Command executed: " << command->toString() << "\n";
+    if (commandLog) {
+        commandLog->recordExecute(*command);
+        YADA_COUNT(CommandsLogged);
+    }
     return true;
 }
 
@@ -174,11 +427,44 @@ bool UndoManager::canUndo() const {
     return !undoStack.empty();
 }
 
-void UndoManager::undo() {
-    if (canUndo()) {
-        undoStack.top()->undo();
+bool UndoManager::undo() {
+    if (!canUndo()) {
+        return false;
+    }
+    YADA_TIME_SCOPE(CommandUndo);
+    if (!undoStack.top()->undo()) {
+        return false;
+    }
+    if (commandLog) {
+        commandLog->recordUndo(*undoStack.top());
+        YADA_COUNT(CommandsLogged);
+    }
+    undoStack.pop();
+    return true;
+}
+
+std::shared_ptr<Command> UndoManager::peek() const {
+    return undoStack.empty() ? nullptr : undoStack.top();
+}
+
+bool UndoManager::replayExecute(std::shared_ptr<Command> command) {
+    if (!command->execute()) {
+        return false;
+    }
+    undoStack.push(command);
+    return true;
+}
+
+bool UndoManager::replayUndo(std::shared_ptr<Command> command) {
+    // The logged command carries its own old values, so it can be undone even
+    // if it was executed before the last snapshot and is not on the stack
+    if (!command->undo()) {
+        return false;
+    }
+    if (!undoStack.empty()) {
         undoStack.pop();
     }
+    return true;
 }
 
 std::vector<std::string> UndoManager::getCommandHistory() const {
@@ -199,19 +485,226 @@ void UndoManager::clearHistory() {
         undoStack.pop();
     }
 }
-AddFoodToDbCommand::AddFoodToDbCommand(FoodDatabase* db, std::shared_ptr<Food> f)
+// Why FoodDatabase::removeFood refused: the food is gone, or the
+// composites listed still use it
+static std::string describeRemovalFailure(FoodDatabase* db, const std::string& id) {
+    const Food* food = db->getFood(id);
+    if (!food) {
+        return "'" + id + "' is not in the database";
+    }
+    std::string users;
+    for (const Food* user : db->getAllDependents(food)) {
+        users += (users.empty() ? "" : ", ") + user->getIdentifier();
+    }
+    return "'" + id + "' is still used by " + users;
+}
+
+AddFoodToDbCommand::AddFoodToDbCommand(FoodDatabase* db, const Food* f)
     : foodDb(db), food(f) {}
 
-void AddFoodToDbCommand::execute() {
-    foodDb->addFood(food);
+bool AddFoodToDbCommand::execute() {
+    if (!foodDb->addFood(food)) {
+        failure = "a food named '" + food->getIdentifier() + "' already exists";
+        return false;
+    }
+    return true;
 }
 
-void AddFoodToDbCommand::undo() {
-    foodDb->removeFood(food->getIdentifier());
+bool AddFoodToDbCommand::undo() {
+    // Blocked (the food stays) if a composite still uses it
+    if (!foodDb->removeFood(food->getIdentifier(), RemovePolicy::Block)) {
+        failure = describeRemovalFailure(foodDb, food->getIdentifier());
+        return false;
+    }
+    return true;
 }
 
 std::string AddFoodToDbCommand::toString() const {
     std::stringstream ss;
     ss << "Add food '" << food->getIdentifier() << "' to database";
     return ss.str();
+}
+
+CommandType AddFoodToDbCommand::getType() const { return CommandType::AddFoodToDb; }
+
+void AddFoodToDbCommand::serialize(std::ostream& out) const {
+    writeString(out, food->getReference());
+    writeString(out, food->serialize());
+}
+
+std::shared_ptr<Command> AddFoodToDbCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string reference, line;
+    if (!readString(in, reference) || !readString(in, line)) return nullptr;
+    
+    // An undo record names a version that is already loaded; parsing would
+    // give the food another one
+    const Food* food = context.foodDb->resolveReference(reference);
+    if (!food || food->serialize() != line) {
+        food = context.foodDb->parseFood(line);
+    }
+    if (!food) return nullptr;
+    return std::make_shared<AddFoodToDbCommand>(context.foodDb, food);
+}
+
+// RemoveFoodFromDbCommand implementation
+RemoveFoodFromDbCommand::RemoveFoodFromDbCommand(FoodDatabase* db, const std::string& id, RemovePolicy p)
+    : foodDb(db), identifier(id), policy(p) {}
+
+bool RemoveFoodFromDbCommand::execute() {
+    removed.clear();
+    removedLines.clear();
+    removedReferences.clear();
+    if (!foodDb->removeFood(identifier, policy, &removed)) {
+        failure = describeRemovalFailure(foodDb, identifier);
+        return false;
+    }
+    for (const Food* food : removed) {
+        removedLines.push_back(food->serialize());
+        removedReferences.push_back(food->getReference());
+    }
+    return true;
+}
+
+bool RemoveFoodFromDbCommand::undo() {
+    // Nothing is restored if a food of the same name was added since
+    for (const Food* food : removed) {
+        if (foodDb->getFood(food->getIdentifier())) {
+            failure = "a food named '" + food->getIdentifier() + "' already exists";
+            return false;
+        }
+    }
+    // Innermost first, so every composite's components are back before it
+    if (!removed.empty()) {
+        for (auto food = removed.rbegin(); food != removed.rend(); ++food) {
+            foodDb->addFood(*food);
+        }
+    } else {
+        for (size_t i = removedLines.size(); i-- > 0;) {
+            // Removed versions are kept, so composites pinned to them come
+            // back whole; a new version only if this one is unknown
+            const Food* food = foodDb->resolveReference(removedReferences[i]);
+            if (!food || food->serialize() != removedLines[i]) {
+                food = foodDb->parseFood(removedLines[i]);
+            }
+            if (food) foodDb->addFood(food);
+        }
+    }
+    return true;
+}
+
+std::string RemoveFoodFromDbCommand::toString() const {
+    std::stringstream ss;
+    ss << "Remove food '" << identifier << "' from database";
+    if (removedLines.size() > 1) {
+        ss << " with " << removedLines.size() - 1 << " composite(s) using it";
+    }
+    return ss.str();
+}
+
+CommandType RemoveFoodFromDbCommand::getType() const { return CommandType::RemoveFoodFromDb; }
+
+void RemoveFoodFromDbCommand::serialize(std::ostream& out) const {
+    writeString(out, identifier);
+    writeUInt8(out, static_cast<uint8_t>(policy));
+    writeUInt32(out, static_cast<uint32_t>(removedLines.size()));
+    for (size_t i = 0; i < removedLines.size(); ++i) {
+        writeString(out, removedReferences[i]);
+        writeString(out, removedLines[i]);
+    }
+}
+
+std::shared_ptr<Command> RemoveFoodFromDbCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string id;
+    uint8_t policy;
+    uint32_t count;
+    if (!readString(in, id) || !readUInt8(in, policy) || !readUInt32(in, count)) return nullptr;
+    
+    auto command = std::make_shared<RemoveFoodFromDbCommand>(context.foodDb, id, static_cast<RemovePolicy>(policy));
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string reference, line;
+        if (!readString(in, reference) || !readString(in, line)) return nullptr;
+        command->removedReferences.push_back(reference);
+        command->removedLines.push_back(line);
+    }
+    return command;
+}
+
+// UpdateFoodCommand implementation
+UpdateFoodCommand::UpdateFoodCommand(FoodDatabase* db, const Food* current, const Food* replacement)
+    : foodDb(db), identifier(current->getIdentifier()), newLine(replacement->serialize()),
+      pending(replacement) {}
+
+UpdateFoodCommand::UpdateFoodCommand(FoodDatabase* db, const std::string& id, const std::string& newL)
+    : foodDb(db), identifier(id), newLine(newL), pending(nullptr) {}
+
+bool UpdateFoodCommand::execute() {
+    const Food* current = foodDb->getFood(identifier);
+    const Food* food = pending ? pending : (current ? foodDb->parseFood(newLine) : nullptr);
+    pending = nullptr;
+    if (!current || !food) {
+        failure = "'" + identifier + "' is not in the database";
+        return false;
+    }
+    std::vector<const Food*> replaced = foodDb->getAllDependents(current);
+    replaced.insert(replaced.begin(), current);
+    if (!foodDb->updateFood(food)) {
+        failure = "'" + identifier + "' is not in the database";
+        return false;
+    }
+    previous = replaced;
+    previousReferences.clear();
+    for (const Food* old : previous) {
+        previousReferences.push_back(old->getReference());
+    }
+    return true;
+}
+
+bool UpdateFoodCommand::undo() {
+    // The replaced versions become live again, so no version is used up
+    if (previous.empty()) {
+        for (const std::string& reference : previousReferences) {
+            const Food* old = foodDb->resolveReference(reference);
+            if (!old) {
+                failure = "version " + reference + " is unknown";
+                return false;
+            }
+            previous.push_back(old);
+        }
+    }
+    if (previous.empty() || !foodDb->restoreFoods(previous)) {
+        failure = "'" + identifier + "' was removed or is used by a food added since";
+        return false;
+    }
+    return true;
+}
+
+std::string UpdateFoodCommand::toString() const {
+    std::stringstream ss;
+    ss << "Edit food '" << identifier << "'";
+    return ss.str();
+}
+
+CommandType UpdateFoodCommand::getType() const { return CommandType::UpdateFood; }
+
+void UpdateFoodCommand::serialize(std::ostream& out) const {
+    writeString(out, identifier);
+    writeString(out, newLine);
+    writeUInt32(out, static_cast<uint32_t>(previousReferences.size()));
+    for (const std::string& reference : previousReferences) {
+        writeString(out, reference);
+    }
+}
+
+std::shared_ptr<Command> UpdateFoodCommand::deserialize(std::istream& in, CommandContext& context) {
+    std::string id, newLine;
+    uint32_t count;
+    if (!readString(in, id) || !readString(in, newLine) || !readUInt32(in, count)) return nullptr;
+    
+    auto command = std::make_shared<UpdateFoodCommand>(context.foodDb, id, newLine);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string reference;
+        if (!readString(in, reference)) return nullptr;
+        command->previousReferences.push_back(reference);
+    }
+    return command;
 }
\ No newline at end of file
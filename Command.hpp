@@ -8,46 +8,103 @@
 #include <stack>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
 #include "FoodDatabase.hpp"
 #include "DietProfile.hpp"
+#include "FoodUsageStats.hpp"
+
+class CommandLog;
+
+// Tags used to identify commands in the binary command log
+enum class CommandType : uint8_t {
+    AddFood = 1,
+    RemoveFood,
+    ChangeDate,
+    AddFoodToDb,
+    SetGender,
+    SetHeight,
+    SetAge,
+    SetWeight,
+    SetActivityLevel,
+    SetCalculator,
+    RemoveFoodFromDb,
+    UpdateFood
+};
+
+// Objects a command may act on, needed to rebuild commands from the log
+struct CommandContext {
+    DailyLog& log;
+    DietProfile& profile;
+    FoodDatabase* foodDb;
+    FoodUsageStats* usage;
+};
 
 // Command pattern for undo functionality
 class Command {
+protected:
+    // Why the last execute() or undo() failed
+    std::string failure;
+    
 public:
     virtual ~Command() = default;
-    virtual void execute() = 0;
-    virtual void undo() = 0;
+    // False if nothing was changed, e.g. FoodDatabase refused a removal;
+    // getFailure() says why
+    virtual bool execute() = 0;
+    virtual bool undo() = 0;
+    const std::string& getFailure() const { return failure; }
     virtual std::string toString() const = 0;
+    virtual CommandType getType() const = 0;
+    // Writes everything needed to both execute and undo the command
+    virtual void serialize(std::ostream& out) const = 0;
+    
+    // Rebuilds a command written by serialize(), nullptr if it cannot be restored
+    static std::shared_ptr<Command> deserialize(CommandType type, std::istream& in, CommandContext& context);
 };
 
 // Add food command
 class AddFoodCommand : public Command {
 private:
     DailyLog& log;
-    std::shared_ptr<Food> food;
+    // The day the entry goes to: the current date when created
+    std::string date;
+    const Food* food;
     double servings;
+    // Optional; updated on execute and undo
+    FoodUsageStats* usage;
     
 public:
-    AddFoodCommand(DailyLog& l, std::shared_ptr<Food> f, double s);
+    AddFoodCommand(DailyLog& l, const Food* f, double s, FoodUsageStats* u = nullptr);
+    AddFoodCommand(DailyLog& l, const std::string& d, const Food* f, double s, FoodUsageStats* u = nullptr);
     
-    void execute() override;
-    void undo() override;
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
 };
 
 // Remove food command
 class RemoveFoodCommand : public Command {
 private:
     DailyLog& log;
+    std::string date;
     int index;
     LogEntry savedEntry;
+    // Optional; the entry's use is taken back on execute, restored on undo
+    FoodUsageStats* usage;
     
 public:
-    RemoveFoodCommand(DailyLog& l, int i);
+    // Removes entry i of the current date
+    RemoveFoodCommand(DailyLog& l, int i, FoodUsageStats* u = nullptr);
+    RemoveFoodCommand(DailyLog& l, const std::string& d, int i, const LogEntry& entry, FoodUsageStats* u = nullptr);
     
-    void execute() override;
-    void undo() override;
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
 };
 
 // Change date command
@@ -59,22 +116,77 @@ private:
     
 public:
     ChangeDateCommand(DailyLog& l, const std::string& newD);
+    ChangeDateCommand(DailyLog& l, const std::string& oldD, const std::string& newD);
     
-    void execute() override;
-    void undo() override;
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
 };
 class AddFoodToDbCommand : public Command {
     private:
         FoodDatabase* foodDb; 
-        std::shared_ptr<Food> food;
+        const Food* food;
         
     public:
-        AddFoodToDbCommand(FoodDatabase* db, std::shared_ptr<Food> f);
-        void execute() override;
-        void undo() override;
+        AddFoodToDbCommand(FoodDatabase* db, const Food* f);
+        bool execute() override;
+        bool undo() override;
         std::string toString() const override;
+        CommandType getType() const override;
+        void serialize(std::ostream& out) const override;
+        static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
     };
+
+// Removes a food from the database; with Cascade also the composites using it
+class RemoveFoodFromDbCommand : public Command {
+private:
+    FoodDatabase* foodDb;
+    std::string identifier;
+    RemovePolicy policy;
+    // What execute() removed, outermost composite first. A command read back
+    // from the log only has the references and serialized lines.
+    std::vector<const Food*> removed;
+    std::vector<std::string> removedReferences;
+    std::vector<std::string> removedLines;
+    
+public:
+    RemoveFoodFromDbCommand(FoodDatabase* db, const std::string& id, RemovePolicy p);
+    bool execute() override;
+    bool undo() override;
+    std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
+};
+
+// Publishes a new version of a food; composites using it get new versions
+// too (see FoodDatabase::updateFood)
+class UpdateFoodCommand : public Command {
+private:
+    FoodDatabase* foodDb;
+    std::string identifier;
+    std::string newLine;
+    // The replacement passed in, used by the first execute() only
+    const Food* pending;
+    // The live versions execute() replaced, the food's first and then its
+    // users'. A command read back from the log only has the references.
+    std::vector<const Food*> previous;
+    std::vector<std::string> previousReferences;
+    
+public:
+    UpdateFoodCommand(FoodDatabase* db, const Food* current, const Food* replacement);
+    UpdateFoodCommand(FoodDatabase* db, const std::string& id, const std::string& newL);
+    bool execute() override;
+    bool undo() override;
+    std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
+};
+
 // UndoManager class
 class SetGenderCommand : public Command {
     private:
@@ -84,9 +196,13 @@ class SetGenderCommand : public Command {
     
     public:
     SetGenderCommand(DietProfile& p, Gender newG);
-    void execute() override;
-    void undo() override;
+    SetGenderCommand(DietProfile& p, Gender oldG, Gender newG);
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
     };
     
     class SetHeightCommand : public Command {
@@ -97,9 +213,13 @@ class SetGenderCommand : public Command {
         
         public:
         SetHeightCommand(DietProfile& p, double newH);
-        void execute() override;
-        void undo() override;
+        SetHeightCommand(DietProfile& p, double oldH, double newH);
+        bool execute() override;
+        bool undo() override;
         std::string toString() const override;
+        CommandType getType() const override;
+        void serialize(std::ostream& out) const override;
+        static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
     };
     
     class SetAgeCommand : public Command {
@@ -110,9 +230,13 @@ class SetGenderCommand : public Command {
         
         public:
         SetAgeCommand(DietProfile& p, int newA);
-        void execute() override;
-        void undo() override;
+        SetAgeCommand(DietProfile& p, int oldA, int newA);
+        bool execute() override;
+        bool undo() override;
         std::string toString() const override;
+        CommandType getType() const override;
+        void serialize(std::ostream& out) const override;
+        static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
     };
     
     class SetWeightCommand : public Command {
@@ -124,9 +248,13 @@ class SetGenderCommand : public Command {
     
     public:
     SetWeightCommand(DietProfile& p, const std::string& d, double newW);
-    void execute() override;
-    void undo() override;
+    SetWeightCommand(DietProfile& p, const std::string& d, double oldW, double newW);
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
 };
     
 class SetActivityLevelCommand : public Command {
@@ -138,9 +266,13 @@ class SetActivityLevelCommand : public Command {
     
     public:
     SetActivityLevelCommand(DietProfile& p, const std::string& d, ActivityLevel newL);
-    void execute() override;
-    void undo() override;
+    SetActivityLevelCommand(DietProfile& p, const std::string& d, ActivityLevel oldL, ActivityLevel newL);
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
     };
     
     class SetCalculatorCommand : public Command {
@@ -151,18 +283,35 @@ class SetActivityLevelCommand : public Command {
     
     public:
     SetCalculatorCommand(DietProfile& p, std::shared_ptr<TargetCalorieCalculator> newCalc);
-    void execute() override;
-    void undo() override;
+    SetCalculatorCommand(DietProfile& p, std::shared_ptr<TargetCalorieCalculator> oldCalc,
+                         std::shared_ptr<TargetCalorieCalculator> newCalc);
+    bool execute() override;
+    bool undo() override;
     std::string toString() const override;
+    CommandType getType() const override;
+    void serialize(std::ostream& out) const override;
+    static std::shared_ptr<Command> deserialize(std::istream& in, CommandContext& context);
 };
 class UndoManager {
 private:
     std::stack<std::shared_ptr<Command>> undoStack;
+    CommandLog* commandLog;
     
 public:
+    UndoManager();
+    
+    // Executed and undone commands are appended to this log (may be nullptr)
+    void setCommandLog(CommandLog* log);
+    // A command that fails is neither kept for undo nor logged
     bool executeCommand(std::shared_ptr<Command> command);
     bool canUndo() const;
-    void undo();
+    // Undoes the last command; if that fails it stays on the stack
+    // (see peek()->getFailure()) and nothing is logged
+    bool undo();
+    std::shared_ptr<Command> peek() const;
+    // Replay helpers used during recovery; they do not write to the log
+    bool replayExecute(std::shared_ptr<Command> command);
+    bool replayUndo(std::shared_ptr<Command> command);
     std::vector<std::string> getCommandHistory() const;
     void clearHistory();
 };
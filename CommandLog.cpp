@@ -0,0 +1,204 @@
+#include "CommandLog.hpp"
+#include "BinaryIO.hpp"
+#include <cstdio>
+#include <exception>
+
+const uint32_t CommandLog::MAGIC;
+
+CommandLog::CommandLog() : logFile("commands.log"), generation(0) {}
+
+void CommandLog::setLogFile(const std::string& file) {
+    close();
+    logFile = file;
+}
+
+bool CommandLog::open() {
+    if (!out.is_open()) {
+        out.open(logFile, std::ios::binary | std::ios::app);
+        if (out.is_open() && out.tellp() == 0) {
+            writeUInt32(out, MAGIC);
+            writeUInt64(out, generation);
+            out.flush();
+        }
+    }
+    return out.is_open();
+}
+
+void CommandLog::close() {
+    if (out.is_open()) {
+        out.close();
+    }
+}
+
+void CommandLog::append(RecordKind kind, const Command& command) {
+    if (!out.is_open()) {
+        return;
+    }
+    
+    std::ostringstream payload;
+    writeUInt8(payload, kind);
+    writeUInt8(payload, static_cast<uint8_t>(command.getType()));
+    command.serialize(payload);
+    
+    const std::string record = payload.str();
+    writeUInt32(out, static_cast<uint32_t>(record.size()));
+    out.write(record.data(), record.size());
+    // Flush every record so a crash loses at most the command in flight
+    out.flush();
+}
+
+void CommandLog::recordExecute(const Command& command) {
+    append(Execute, command);
+}
+
+void CommandLog::recordUndo(const Command& command) {
+    append(Undo, command);
+}
+
+std::string CommandLog::getSnapshotFile() const {
+    return logFile + ".snapshot";
+}
+
+uint64_t CommandLog::readSnapshotGeneration() const {
+    std::ifstream in(getSnapshotFile(), std::ios::binary);
+    uint64_t value = 0;
+    if (!in.is_open() || !readUInt64(in, value)) {
+        return 0;
+    }
+    return value;
+}
+
+bool CommandLog::writeSnapshotGeneration(uint64_t value) const {
+    // Written aside and renamed over the old one, so it is never torn
+    std::string temp = getSnapshotFile() + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        writeUInt64(file, value);
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temp.c_str(), getSnapshotFile().c_str()) == 0;
+}
+
+bool CommandLog::rewrite(const std::string& records) {
+    bool wasOpen = out.is_open();
+    close();
+    
+    std::ofstream file(logFile, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    writeUInt32(file, MAGIC);
+    writeUInt64(file, generation);
+    file.write(records.data(), records.size());
+    file.close();
+    
+    return !wasOpen || open();
+}
+
+int CommandLog::replay(UndoManager& undoManager, CommandContext& context) {
+    replayError.clear();
+    uint64_t snapshot = readSnapshotGeneration();
+    generation = snapshot;
+    std::ifstream in(logFile, std::ios::binary);
+    if (!in.is_open()) {
+        return 0;
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    if (contents.empty()) {
+        return 0;
+    }
+    
+    std::istringstream log(contents);
+    uint32_t magic;
+    uint64_t logGeneration;
+    if (!readUInt32(log, magic) || !readUInt64(log, logGeneration) || magic != MAGIC) {
+        replayError = "unrecognized log header";
+        std::ofstream(logFile + ".rejected", std::ios::binary) << contents;
+        rewrite("");
+        return 0;
+    }
+    if (logGeneration < snapshot) {
+        // Saved, but the program stopped before the log was cleared
+        rewrite("");
+        return 0;
+    }
+    generation = logGeneration;
+    
+    const size_t headerSize = sizeof(uint32_t) + sizeof(uint64_t);
+    size_t end = headerSize; // End of the last record applied
+    int applied = 0;
+    uint32_t size;
+    while (readUInt32(log, size)) {
+        // Checked before allocating: a damaged length word can claim up to 4 GiB
+        size_t remaining = contents.size() - static_cast<size_t>(log.tellg());
+        if (size == 0 || size > remaining) {
+            break; // Torn write at the end of the log
+        }
+        std::string record(size, '\0');
+        log.read(&record[0], size);
+        
+        std::istringstream recordStream(record);
+        uint8_t kind, type;
+        std::shared_ptr<Command> command;
+        try {
+            if (readUInt8(recordStream, kind) && readUInt8(recordStream, type) && (kind == Execute || kind == Undo)) {
+                command = Command::deserialize(static_cast<CommandType>(type), recordStream, context);
+            }
+            if (!command) {
+                // Later records may depend on this one (e.g. entry indexes),
+                // so none of them can be applied either
+                replayError = "record " + std::to_string(applied + 1) + " refers to data that no longer exists";
+                break;
+            }
+            bool replayed = kind == Execute ? undoManager.replayExecute(command)
+                                            : undoManager.replayUndo(command);
+            if (!replayed) {
+                replayError = "record " + std::to_string(applied + 1) + " could not be applied (" +
+                              command->getFailure() + ")";
+                break;
+            }
+        } catch (const std::exception& e) {
+            replayError = "record " + std::to_string(applied + 1) + " is damaged (" + e.what() + ")";
+            break;
+        }
+        end = static_cast<size_t>(log.tellg());
+        ++applied;
+    }
+    
+    if (end < contents.size()) {
+        // Drop what was not applied, so new records are not appended after it
+        if (!replayError.empty()) {
+            std::ofstream(logFile + ".rejected", std::ios::binary) << contents.substr(end);
+        }
+        rewrite(contents.substr(headerSize, end - headerSize));
+    }
+    return applied;
+}
+
+const std::string& CommandLog::getReplayError() const {
+    return replayError;
+}
+
+bool CommandLog::hasUnsavedRecords() const {
+    std::ifstream in(logFile, std::ios::binary);
+    uint32_t magic;
+    uint64_t logGeneration;
+    if (!in.is_open() || in.peek() == std::ifstream::traits_type::eof()) {
+        return false;
+    }
+    if (!readUInt32(in, magic) || !readUInt64(in, logGeneration) || magic != MAGIC) {
+        return true; // replay() would reject it
+    }
+    return logGeneration >= readSnapshotGeneration() && in.peek() != std::ifstream::traits_type::eof();
+}
+
+bool CommandLog::checkpoint() {
+    if (!writeSnapshotGeneration(generation + 1)) {
+        return false;
+    }
+    ++generation;
+    return rewrite("");
+}
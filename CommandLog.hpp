@@ -0,0 +1,65 @@
+#ifndef COMMAND_LOG_HPP
+#define COMMAND_LOG_HPP
+
+#include "Command.hpp"
+#include <string>
+#include <fstream>
+
+// Append-only binary log of executed and undone commands.
+// Together with the last saved data files (the snapshot) it allows the
+// session to be recovered by replaying the tail of commands after a restart.
+//
+// Header: [uint32 magic][uint64 generation]
+// Record layout: [uint32 payload size][uint8 record kind][uint8 command type][command payload]
+//
+// Every save bumps the generation and writes it to "<log>.snapshot" before
+// the log is cleared, so a log whose generation is older than the snapshot
+// is known to be already contained in the saved files and is not replayed.
+class CommandLog {
+private:
+    enum RecordKind : uint8_t {
+        Execute = 1,
+        Undo = 2
+    };
+    static const uint32_t MAGIC = 0x4C434159; // "YACL"
+    
+    std::string logFile;
+    std::ofstream out;
+    // Generation of the snapshot the records apply to
+    uint64_t generation;
+    std::string replayError;
+    
+    void append(RecordKind kind, const Command& command);
+    std::string getSnapshotFile() const;
+    uint64_t readSnapshotGeneration() const;
+    bool writeSnapshotGeneration(uint64_t value) const;
+    // Rewrites the log as the header followed by the given raw records
+    bool rewrite(const std::string& records);
+    
+public:
+    CommandLog();
+    
+    void setLogFile(const std::string& file);
+    bool open();
+    void close();
+    
+    void recordExecute(const Command& command);
+    void recordUndo(const Command& command);
+    
+    // Replays all complete records on top of the loaded snapshot, stopping
+    // at the first record that cannot be read or applied (see
+    // getReplayError()); the records from there on are moved to
+    // "<log>.rejected". Returns the number of records applied.
+    int replay(UndoManager& undoManager, CommandContext& context);
+    // Why the last replay stopped early, empty if it read the whole log
+    const std::string& getReplayError() const;
+    // True if replay() would have records to apply (or reject): anything
+    // after the header of a log not already contained in the snapshot
+    bool hasUnsavedRecords() const;
+    
+    // Marks the snapshot as saved and discards all records; called once
+    // every data file has been written
+    bool checkpoint();
+};
+
+#endif // COMMAND_LOG_HPP
@@ -1,23 +1,43 @@
 #include "DailyLog.hpp"
 #include "FoodDatabase.hpp"
+#include "Metrics.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
 
-LogEntry::LogEntry(std::shared_ptr<Food> f, double s) : food(f), servings(s) {}
+LogEntry::LogEntry(const Food* f, double s) : food(f), servings(s) {}
 
 double LogEntry::getCalories() const {
-    return food->getCaloriesPerServing() * servings;
+    return food->calories() * servings;
+}
+
+NutrientVector LogEntry::getNutrients() const {
+    NutrientVector nutrients;
+    food->addNutrients(nutrients, servings);
+    return nutrients;
 }
 
 std::string LogEntry::toString() const {
-    std::stringstream ss;
-    ss << servings << " serving(s) of " << food->getIdentifier() 
-       << " (" << getCalories() << " calories)";
-    return ss.str();
+    TextWriter out;
+    describeTo(out);
+    return out.str();
 }
 
 std::string LogEntry::serialize() const {
-    std::stringstream ss;
-    ss << food->getIdentifier() << ":" << servings;
-    return ss.str();
+    TextWriter out;
+    serializeTo(out);
+    return out.str();
+}
+
+void LogEntry::describeTo(TextWriter& out) const {
+    out << servings << " serving(s) of " << food->getIdentifier()
+        << " (" << getCalories() << " calories)";
+}
+
+void LogEntry::serializeTo(TextWriter& out) const {
+    // Pinned to the food's version, so later edits don't change the past
+    food->writeReference(out);
+    out << ":" << servings;
 }
 
 // DayLog implementation
@@ -43,22 +63,104 @@ double DayLog::getTotalCalories() const {
     return total;
 }
 
+NutrientVector DayLog::getTotalNutrients() const {
+    NutrientVector total;
+    for (const auto& entry : entries) {
+        entry.food->addNutrients(total, entry.servings);
+    }
+    return total;
+}
+
 std::string DayLog::toString() const {
-    std::stringstream ss;
-    ss << "Daily Food Log:\n";
+    TextWriter out;
+    describeTo(out);
+    return out.str();
+}
+
+void DayLog::describeTo(TextWriter& out) const {
+    out << "Daily Food Log:\n";
     for (size_t i = 0; i < entries.size(); ++i) {
-        ss << i + 1 << ". " << entries[i].toString() << "\n";
+        out << i + 1 << ". ";
+        entries[i].describeTo(out);
+        out << "\n";
+    }
+    NutrientVector total = getTotalNutrients();
+    out << "Total Calories: " << total.get(Nutrient::Calories) << "\n";
+    if (total.hasNonCalorieValues()) {
+        out << "Protein: " << total.get(Nutrient::Protein) << "g, Fat: " << total.get(Nutrient::Fat)
+            << "g, Carbs: " << total.get(Nutrient::Carbohydrates) << "g, Fiber: " << total.get(Nutrient::Fiber)
+            << "g, Sodium: " << total.get(Nutrient::Sodium) << "mg\n";
+    }
+}
+
+namespace {
+    // Parses the entries of a "date;food:servings,..." line
+    DayLog parseDayLine(const std::string& line) {
+        std::istringstream iss(line);
+        std::string date, entriesStr;
+        
+        std::getline(iss, date, ';');
+        std::getline(iss, entriesStr);
+        
+        DayLog dayLog;
+        std::istringstream entriesStream(entriesStr);
+        std::string entryStr;
+        
+        while (std::getline(entriesStream, entryStr, ',')) {
+            std::istringstream entryParts(entryStr);
+            std::string foodId, servingsStr;
+            
+            std::getline(entryParts, foodId, ':');
+            std::getline(entryParts, servingsStr);
+            double servings = std::stod(servingsStr);
+            
+            auto food = FoodDatabase::getInstance()->resolveReference(foodId);
+            if (food) {
+                dayLog.addEntry(LogEntry(food, servings));
+            }
+        }
+        return dayLog;
+    }
+    
+    bool readSpan(std::istream& file, const LogSpan& span, std::string& line) {
+        file.clear();
+        file.seekg(span.offset);
+        line.resize(span.length);
+        return span.length == 0 || static_cast<bool>(file.read(&line[0], span.length));
+    }
+    
+    // Bytes hashed at each end of the log for the index stamp
+    const std::streamoff STAMP_SAMPLE = 4096;
+    
+    // FNV-1a over length bytes at offset
+    uint64_t hashBytes(std::istream& file, std::streamoff offset, std::streamoff length, uint64_t hash) {
+        std::string bytes(static_cast<size_t>(length), '\0');
+        file.clear();
+        file.seekg(offset);
+        if (length > 0 && !file.read(&bytes[0], length)) {
+            return 0;
+        }
+        for (char c : bytes) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+        return hash;
     }
-    ss << "Total Calories: " << getTotalCalories() << "\n";
-    return ss.str();
 }
 
 // DailyLog implementation
-DailyLog::DailyLog() : logFile("dailylog.txt") {
+DailyLog::DailyLog() : logFile("dailylog.txt"), revision(0) {
     // Set current date as default
     time_t now = time(0);
     tm* ltm = localtime(&now);
     currentDate = formatDate(1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday);
+    lastChange = LogChange{LogChangeKind::DateSelected, currentDate, 0.0};
+}
+
+void DailyLog::recordChange(LogChangeKind kind, const std::string& date, double calorieDelta) {
+    if (kind != LogChangeKind::DateSelected) {
+        ++revision;
+    }
+    lastChange = LogChange{kind, date, calorieDelta};
 }
 
 std::string DailyLog::formatDate(int year, int month, int day) {
@@ -79,75 +181,84 @@ const std::string& DailyLog::getCurrentDate() const {
 
 void DailyLog::setCurrentDate(const std::string& date) {
     currentDate = date;
+    recordChange(LogChangeKind::DateSelected, date, 0.0);
     notifyObservers();
 }
 
 DayLog& DailyLog::getCurrentDayLog() {
+    ensureLoaded(currentDate);
     return logs[currentDate];
 }
 
 const DayLog& DailyLog::getCurrentDayLog() const {
+    ensureLoaded(currentDate);
     return logs.at(currentDate);
 }
 
 bool DailyLog::dateExists(const std::string& date) const {
-    return logs.find(date) != logs.end();
+    return logs.find(date) != logs.end() || unloaded.find(date) != unloaded.end();
+}
+
+const DayLog* DailyLog::findDayLog(const std::string& date) const {
+    ensureLoaded(date);
+    auto it = logs.find(date);
+    return it != logs.end() ? &it->second : nullptr;
 }
 
 std::vector<std::string> DailyLog::getAllDates() const {
     std::vector<std::string> dates;
-    for (const auto& pair : logs) {
-        dates.push_back(pair.first);
-    }
-    std::sort(dates.begin(), dates.end());
+    dates.reserve(logs.size() + unloaded.size());
+    forEachDate([&dates](const std::string& date) { dates.push_back(date); });
     return dates;
 }
 
-void DailyLog::addFoodToCurrentDay(std::shared_ptr<Food> food, double servings) {
-    logs[currentDate].addEntry(LogEntry(food, servings));
-    notifyObservers();
+void DailyLog::addFoodToCurrentDay(const Food* food, double servings) {
+    addFoodToDay(currentDate, food, servings);
 }
 
 void DailyLog::removeFoodFromCurrentDay(int index) {
-    logs[currentDate].removeEntry(index);
+    removeFoodFromDay(currentDate, index);
+}
+
+void DailyLog::addFoodToDay(const std::string& date, const Food* food, double servings) {
+    ensureLoaded(date);
+    LogEntry entry(food, servings);
+    logs[date].addEntry(entry);
+    recordChange(LogChangeKind::EntryAdded, date, entry.getCalories());
+    notifyObservers();
+}
+
+void DailyLog::removeFoodFromDay(const std::string& date, int index) {
+    ensureLoaded(date);
+    DayLog& dayLog = logs[date];
+    double removedCalories = 0.0;
+    if (index >= 0 && index < static_cast<int>(dayLog.getEntries().size())) {
+        removedCalories = dayLog.getEntries()[index].getCalories();
+    }
+    dayLog.removeEntry(index);
+    recordChange(LogChangeKind::EntryRemoved, date, -removedCalories);
     notifyObservers();
 }
 
 bool DailyLog::loadLog() {
+    YADA_TIME_SCOPE(LoadLog);
     logs.clear();
-    std::ifstream file(logFile);
+    unloaded.clear();
+    recordChange(LogChangeKind::Reloaded, "", 0.0);
+    std::ifstream file(logFile, std::ios::binary);
     if (!file.is_open()) {
-        std::cout << "Could not open log file. Creating a new one when saving." << std::endl;
         return false;
     }
     
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string date, entriesStr;
-        
-        std::getline(iss, date, ';');
-        std::getline(iss, entriesStr);
-        
-        DayLog dayLog;
-        std::istringstream entriesStream(entriesStr);
-        std::string entryStr;
-        
-        while (std::getline(entriesStream, entryStr, ',')) {
-            std::istringstream entryParts(entryStr);
-            std::string foodId, servingsStr;
-            
-            std::getline(entryParts, foodId, ':');
-            std::getline(entryParts, servingsStr);
-            double servings = std::stod(servingsStr);
-            
-            auto food = FoodDatabase::getInstance()->getFood(foodId);
-            if (food) {
-                dayLog.addEntry(LogEntry(food, servings));
-            }
-        }
-        
-        logs[date] = dayLog;
+    // Only index the days; they are parsed on first access
+    file.seekg(0, std::ios::end);
+    std::streamoff logSize = file.tellg();
+    std::string stamp = getLogStamp(file, logSize);
+    if (!readIndex(stamp, logSize)) {
+        file.clear();
+        file.seekg(0);
+        scanLog(file);
+        writeIndex(unloaded, stamp);
     }
     
     file.close();
@@ -155,22 +266,196 @@ bool DailyLog::loadLog() {
 }
 
 bool DailyLog::saveLog() {
-    std::ofstream file(logFile);
+    YADA_TIME_SCOPE(SaveLog);
+    // Write a new file next to the old one, since days that were never
+    // loaded are copied from the old file, then replace it
+    std::string tempFile = logFile + ".tmp";
+    std::ofstream file(tempFile, std::ios::binary);
     if (!file.is_open()) {
-        std::cout << "Could not open log file for writing." << std::endl;
         return false;
     }
-    
-    for (const auto& pair : logs) {
-        file << pair.first << ";";
-        const auto& entries = pair.second.getEntries();
-        for (size_t i = 0; i < entries.size(); ++i) {
-            file << entries[i].serialize();
-            if (i < entries.size() - 1) file << ",";
+    std::ifstream source;
+    if (!unloaded.empty()) {
+        source.open(logFile, std::ios::binary);
+        if (!source.is_open()) {
+            return false;
         }
-        file << std::endl;
     }
     
+    std::map<std::string, LogSpan> spans;
+    std::streamoff offset = 0;
+    TextWriter out(&file);
+    TextWriter line;
+    std::string raw;
+    auto loaded = logs.begin();
+    auto stored = unloaded.begin();
+    while (loaded != logs.end() || stored != unloaded.end()) {
+        std::string date;
+        if (stored == unloaded.end() || (loaded != logs.end() && loaded->first < stored->first)) {
+            line.clear();
+            line << loaded->first << ";";
+            const auto& entries = loaded->second.getEntries();
+            for (size_t i = 0; i < entries.size(); ++i) {
+                entries[i].serializeTo(line);
+                if (i < entries.size() - 1) line << ",";
+            }
+            raw = line.str();
+            date = loaded->first;
+            ++loaded;
+        } else {
+            if (!readSpan(source, stored->second, raw)) {
+                file.close();
+                std::remove(tempFile.c_str());
+                return false;
+            }
+            date = stored->first;
+            ++stored;
+        }
+        out << raw << '\n';
+        spans[date] = LogSpan{offset, raw.size()};
+        offset += static_cast<std::streamoff>(raw.size()) + 1;
+    }
+    out.flush();
     file.close();
+    source.close();
+    if (!file) {
+        std::remove(tempFile.c_str());
+        return false;
+    }
+    
+    if (std::rename(tempFile.c_str(), logFile.c_str()) != 0) {
+        // Some platforms refuse to rename over an existing file
+        std::remove(logFile.c_str());
+        if (std::rename(tempFile.c_str(), logFile.c_str()) != 0) {
+            return false;
+        }
+    }
+    
+    // Days that are still unloaded now live at their new positions
+    for (auto& pair : unloaded) {
+        pair.second = spans[pair.first];
+    }
+    std::ifstream saved(logFile, std::ios::binary);
+    writeIndex(spans, getLogStamp(saved, offset));
     return true;
-}
\ No newline at end of file
+}
+
+std::string DailyLog::getIndexFile() const {
+    return logFile + ".idx";
+}
+
+// Identifies the log contents the index was written for: its size, its
+// modification time and a hash of its first and last STAMP_SAMPLE bytes
+// (so an edit that keeps the size, or the time, is still noticed)
+std::string DailyLog::getLogStamp(std::istream& file, std::streamoff logSize) const {
+    struct stat info;
+    long long modified = stat(logFile.c_str(), &info) == 0 ? static_cast<long long>(info.st_mtime) : 0;
+    std::streamoff head = std::min(logSize, STAMP_SAMPLE);
+    std::streamoff tail = std::min(logSize - head, STAMP_SAMPLE);
+    uint64_t hash = hashBytes(file, 0, head, 14695981039346656037ULL);
+    hash = hashBytes(file, logSize - tail, tail, hash);
+    
+    TextWriter out;
+    out << "size;" << static_cast<long long>(logSize) << ";mtime;" << modified << ";hash;" << std::to_string(static_cast<unsigned long long>(hash));
+    return out.str();
+}
+
+bool DailyLog::readIndex(const std::string& stamp, std::streamoff logSize) {
+    // Format: the log stamp then one "date;offset;length" line per day.
+    // The index is only trusted if it was written for this exact log.
+    std::ifstream file(getIndexFile());
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || line != stamp) {
+        return false;
+    }
+    
+    while (std::getline(file, line)) {
+        size_t first = line.find(';');
+        size_t second = line.find(';', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            unloaded.clear();
+            return false;
+        }
+        LogSpan span;
+        span.offset = std::strtoll(line.c_str() + first + 1, nullptr, 10);
+        span.length = std::strtoull(line.c_str() + second + 1, nullptr, 10);
+        if (span.offset < 0 || span.offset + static_cast<std::streamoff>(span.length) > logSize) {
+            unloaded.clear();
+            return false;
+        }
+        unloaded[line.substr(0, first)] = span;
+    }
+    return true;
+}
+
+void DailyLog::scanLog(std::istream& file) {
+    std::string line;
+    std::streamoff offset = 0;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            unloaded[line.substr(0, line.find(';'))] = LogSpan{offset, line.size()};
+        }
+        offset += static_cast<std::streamoff>(line.size()) + 1;
+    }
+}
+
+bool DailyLog::writeIndex(const std::map<std::string, LogSpan>& spans, const std::string& stamp) const {
+    std::ofstream file(getIndexFile());
+    if (!file.is_open()) {
+        return false;
+    }
+    TextWriter out(&file);
+    out << stamp << '\n';
+    for (const auto& pair : spans) {
+        out << pair.first << ";" << static_cast<long long>(pair.second.offset) << ";"
+            << pair.second.length << '\n';
+    }
+    out.flush();
+    return static_cast<bool>(file);
+}
+
+void DailyLog::ensureLoaded(const std::string& date) const {
+    if (unloaded.find(date) != unloaded.end()) {
+        loadRange(date, date);
+    }
+}
+
+void DailyLog::loadRange(const std::string& first, const std::string& last) const {
+    auto begin = unloaded.lower_bound(first);
+    auto end = unloaded.upper_bound(last);
+    if (begin == end) {
+        return;
+    }
+    
+    std::ifstream file(logFile, std::ios::binary);
+    std::string line;
+    for (auto it = begin; it != end; ++it) {
+        // A day that can no longer be read (file changed underneath) starts empty
+        DayLog& dayLog = logs[it->first];
+        if (file.is_open() && readSpan(file, it->second, line)) {
+            dayLog = parseDayLine(line);
+        }
+    }
+    unloaded.erase(begin, end);
+}
+
+void DailyLog::loadAll() const {
+    if (!unloaded.empty()) {
+        // Copied: loadRange() erases the entries they would refer to
+        std::string first = unloaded.begin()->first;
+        std::string last = unloaded.rbegin()->first;
+        loadRange(first, last);
+    }
+}
+
+size_t DailyLog::getLoadedDayCount() const {
+    return logs.size();
+}
+
+uint64_t DailyLog::getRevision() const {
+    return revision;
+}
+
+const LogChange& DailyLog::getLastChange() const {
+    return lastChange;
+}
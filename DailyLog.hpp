@@ -6,10 +6,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 #include <memory>
 #include <ctime>
 #include <algorithm>
-#include <iostream>
 #include <fstream>
 #include <sstream>
 
@@ -19,13 +19,18 @@ class FoodDatabase;
 // LogEntry class for individual food entries
 class LogEntry {
 public:
-    std::shared_ptr<Food> food;
+    // Owned by the FoodDatabase. The version in effect when it was logged;
+    // editing the food later publishes a new version and leaves this one.
+    const Food* food;
     double servings;
     
-    LogEntry(std::shared_ptr<Food> f, double s);
+    LogEntry(const Food* f, double s);
     double getCalories() const;
+    NutrientVector getNutrients() const;
     std::string toString() const;
     std::string serialize() const;
+    void describeTo(TextWriter& out) const;
+    void serializeTo(TextWriter& out) const;
 };
 
 // DayLog class for a single day's log
@@ -38,15 +43,56 @@ public:
     void removeEntry(int index);
     const std::vector<LogEntry>& getEntries() const;
     double getTotalCalories() const;
+    NutrientVector getTotalNutrients() const;
     std::string toString() const;
+    void describeTo(TextWriter& out) const;
 };
 
-// DailyLog class for all dates
+// What the last notification was about, so observers can update incrementally
+enum class LogChangeKind {
+    DateSelected,
+    EntryAdded,
+    EntryRemoved,
+    Reloaded
+};
+
+struct LogChange {
+    LogChangeKind kind;
+    std::string date;
+    // Change in the date's consumed calories (entry added/removed)
+    double calorieDelta;
+};
+
+// Where a day's line sits in the log file
+struct LogSpan {
+    std::streamoff offset;
+    size_t length;
+};
+
+// DailyLog class for all dates.
+// Loading only builds a date -> line index (read from the "<log>.idx"
+// sidecar written on save, or by scanning the file if it is missing or
+// stale); a day is parsed the first time it is accessed. Saving copies the
+// lines of days that were never loaded straight from the old file.
 class DailyLog : public Subject {
 private:
-    std::map<std::string, DayLog> logs;
+    // Days parsed so far
+    mutable std::map<std::string, DayLog> logs;
+    // Days still only in the log file
+    mutable std::map<std::string, LogSpan> unloaded;
     std::string currentDate;
     std::string logFile;
+    // Bumped on every change to logged entries (not on date selection)
+    uint64_t revision;
+    LogChange lastChange;
+    
+    void recordChange(LogChangeKind kind, const std::string& date, double calorieDelta);
+    std::string getIndexFile() const;
+    std::string getLogStamp(std::istream& file, std::streamoff logSize) const;
+    bool readIndex(const std::string& stamp, std::streamoff logSize);
+    void scanLog(std::istream& file);
+    bool writeIndex(const std::map<std::string, LogSpan>& spans, const std::string& stamp) const;
+    void ensureLoaded(const std::string& date) const;
     
     std::string formatDate(int year, int month, int day);
     
@@ -59,11 +105,56 @@ public:
     DayLog& getCurrentDayLog();
     const DayLog& getCurrentDayLog() const;
     bool dateExists(const std::string& date) const;
+    // nullptr if nothing was logged for the date
+    const DayLog* findDayLog(const std::string& date) const;
+    // Parses all days in [first, last] up front, e.g. before reading them
+    // from several threads (paging in is not thread-safe)
+    void loadRange(const std::string& first, const std::string& last) const;
+    void loadAll() const;
+    size_t getLoadedDayCount() const;
+    // Sorted copy of every date; forEachDate() avoids the copies
     std::vector<std::string> getAllDates() const;
-    void addFoodToCurrentDay(std::shared_ptr<Food> food, double servings);
+    // Calls visit(date) for every date in order, reading the dates in
+    // place. visit must not page days in (findDayLog(), loadRange()).
+    template <typename Visitor>
+    void forEachDate(Visitor visit) const;
+    // Pages every day in, then calls visit(date, dayLog) for each in order.
+    // Both references stay valid until the log is next changed.
+    template <typename Visitor>
+    void forEachDay(Visitor visit) const;
+    void addFoodToCurrentDay(const Food* food, double servings);
     void removeFoodFromCurrentDay(int index);
+    // Same for any date; commands use these so they act on the day they
+    // were created for, whatever date is selected when they run
+    void addFoodToDay(const std::string& date, const Food* food, double servings);
+    void removeFoodFromDay(const std::string& date, int index);
     bool loadLog();
     bool saveLog();
+    
+    uint64_t getRevision() const;
+    const LogChange& getLastChange() const;
 };
 
+template <typename Visitor>
+void DailyLog::forEachDate(Visitor visit) const {
+    // Both maps are sorted and never share a date: merge them
+    auto parsed = logs.begin();
+    auto pending = unloaded.begin();
+    while (parsed != logs.end() || pending != unloaded.end()) {
+        if (pending == unloaded.end() || (parsed != logs.end() && parsed->first < pending->first)) {
+            visit((parsed++)->first);
+        } else {
+            visit((pending++)->first);
+        }
+    }
+}
+
+template <typename Visitor>
+void DailyLog::forEachDay(Visitor visit) const {
+    loadAll();
+    for (const auto& pair : logs) {
+        visit(pair.first, pair.second);
+    }
+}
+
 #endif // DAILY_LOG_HPP
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef DATES_HPP
+#define DATES_HPP
+
+#include <cstdio>
+#include <string>
+
+// Conversions between "YYYY-MM-DD" strings and day numbers (days since
+// 1970-01-01, proleptic Gregorian calendar) for date arithmetic.
+
+inline long daysFromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const long era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<long>(dayOfEra) - 719468;
+}
+
+inline std::string formatDayNumber(long days) {
+    days += 719468;
+    const long era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned mp = (5 * dayOfYear + 2) / 153;
+    const unsigned day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    const long year = static_cast<long>(yearOfEra) + era * 400 + (month <= 2);
+    
+    char buffer[32]; // Fits any long year, so -Wformat-truncation stays quiet
+    std::snprintf(buffer, sizeof(buffer), "%04ld-%02u-%02u", year, month, day);
+    return buffer;
+}
+
+// False if date is not of the form YYYY-MM-DD
+inline bool parseDayNumber(const std::string& date, long& dayNumber) {
+    int year;
+    unsigned month, day;
+    if (std::sscanf(date.c_str(), "%d-%u-%u", &year, &month, &day) != 3 ||
+        month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    dayNumber = daysFromCivil(year, month, day);
+    return true;
+}
+
+#endif // DATES_HPP
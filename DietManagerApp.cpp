@@ -1,4 +1,7 @@
 #include "DietManagerApp.hpp"
+#include "Metrics.hpp"
+#include <fstream>
+#include <sstream>
 
 DietManagerApp::DietManagerApp() 
     : foodDb(FoodDatabase::getInstance()), 
@@ -7,15 +10,63 @@ DietManagerApp::DietManagerApp()
 }
 
 void DietManagerApp::init() {
-    // Load data
-    foodDb->loadDatabase();
-    log.loadLog();
-    profile.loadProfile();
+    // Load data; a missing file just means starting empty
+    if (!foodDb->loadDatabase()) {
+        std::cout << "Could not open database file. Creating a new one when saving." << std::endl;
+    }
+    for (const std::string& error : foodDb->getLoadErrors()) {
+        std::cout << "Warning: " << error << "." << std::endl;
+    }
+    if (!log.loadLog()) {
+        std::cout << "Could not open log file. Creating a new one when saving." << std::endl;
+    }
+    if (!profile.loadProfile()) {
+        std::cout << "Could not open profile file. Creating a new one when saving." << std::endl;
+    }
+    if (!usageStats.load()) {
+        // First run with usage tracking: count what is already in the log
+        usageStats.rebuild(log);
+    }
+    foodDb->setUsageStats(&usageStats);
+    recoverSession();
     
     std::cout << "Welcome to YADA (Yet Another Diet Assistant)!\n";
     tracker.displayDailySummary();
 }
 
+void DietManagerApp::recoverSession() {
+    // Apply the commands executed since the last save on top of the loaded files.
+    // The tracker is detached so replay does not print a summary per command.
+    log.removeObserver(&tracker);
+    profile.removeObserver(&tracker);
+    
+    CommandContext context{log, profile, foodDb, &usageStats};
+    int replayed = commandLog.replay(undoManager, context);
+    
+    log.addObserver(&tracker);
+    profile.addObserver(&tracker);
+    
+    if (replayed > 0) {
+        std::cout << "Recovered " << replayed << " unsaved action(s) from the previous session.\n";
+    }
+    if (!commandLog.getReplayError().empty()) {
+        std::cout << "Recovery stopped early: " << commandLog.getReplayError() << ".\n"
+                  << "The remaining actions were not applied; they were kept in commands.log.rejected.\n";
+    }
+    
+    commandLog.open();
+    undoManager.setCommandLog(&commandLog);
+}
+
+bool DietManagerApp::runCommand(std::shared_ptr<Command> command) {
+    if (!undoManager.executeCommand(command)) {
+        std::cout << "Command failed: " << command->getFailure() << ".\n";
+        return false;
+    }
+    std::cout << "Command executed: " << command->toString() << "\n";
+    return true;
+}
+
 void DietManagerApp::run() {
     init();
     
@@ -32,9 +83,11 @@ void DietManagerApp::run() {
             case 3: manageProfile(); break;
             case 4: selectDate(); break;
             case 5: 
-                if (undoManager.canUndo()) {
-                    undoManager.undo();
+                if (undoManager.undo()) {
                     std::cout << "Last action undone.\n";
+                } else if (undoManager.canUndo()) {
+                    std::cout << "Could not undo \"" << undoManager.peek()->toString() << "\": "
+                              << undoManager.peek()->getFailure() << ".\n";
                 } else {
                     std::cout << "Nothing to undo.\n";
                 }
@@ -42,7 +95,13 @@ void DietManagerApp::run() {
             case 6:
                 saveData();
                 break;
-            case 7: 
+            case 7:
+                showMetrics();
+                break;
+            case 8:
+                showReports();
+                break;
+            case 9: 
                 running = false;
                 saveData();
                 std::cout << "Thank you for using YADA. Goodbye!\n";
@@ -61,7 +120,9 @@ void DietManagerApp::displayMainMenu() {
     std::cout << "4. Select Date\n";
     std::cout << "5. Undo Last Action\n";
     std::cout << "6. Save Data\n";
-    std::cout << "7. Exit\n";
+    std::cout << "7. Show Metrics\n";
+    std::cout << "8. Reports\n";
+    std::cout << "9. Exit\n";
     std::cout << "Enter choice: ";
 }
 
@@ -72,7 +133,9 @@ void DietManagerApp::manageFoods() {
         std::cout << "2. Search Foods\n";
         std::cout << "3. Add Basic Food\n";
         std::cout << "4. Create Composite Food\n";
-        std::cout << "5. Back to Main Menu\n";
+        std::cout << "5. Remove Food\n";
+        std::cout << "6. Edit Food\n";
+        std::cout << "7. Back to Main Menu\n";
         std::cout << "Enter choice: ";
         
         int choice;
@@ -88,7 +151,9 @@ void DietManagerApp::manageFoods() {
             case 2: searchFoods(); break;
             case 3: addBasicFood(); break;
             case 4: createCompositeFood(); break;
-            case 5: return;
+            case 5: removeFoodFromDb(); break;
+            case 6: editFood(); break;
+            case 7: return;
             default: std::cout << "Invalid choice. Try again.\n";
         }
     }
@@ -96,14 +161,17 @@ void DietManagerApp::manageFoods() {
 
 void DietManagerApp::viewAllFoods() {
     std::cout << "\n===== All Foods =====\n";
-    auto foods = foodDb->getAllFoods();
+    FoodSpan foods = foodDb->viewAllFoods();
     if (foods.empty()) {
         std::cout << "No foods in database.\n";
         return;
     }
     
+    TextWriter out(&std::cout);
     for (size_t i = 0; i < foods.size(); ++i) {
-        std::cout << i + 1 << ". " << foods[i]->toString() << "\n";
+        out << i + 1 << ". ";
+        foods[i]->describeTo(out);
+        out << "\n";
     }
 }
 
@@ -125,22 +193,55 @@ void DietManagerApp::searchFoods() {
         }
     }
     
-    std::cout << "Match (1) All keywords or (2) Any keyword? ";
+    std::cout << "Match (1) All keywords, (2) Any keyword, (3) All keywords allowing typos"
+              << " or (4) Any keyword allowing typos? ";
     int matchChoice;
     std::cin >> matchChoice;
     std::cin.ignore();
     
-    bool matchAll = (matchChoice == 1);
-    auto results = foodDb->findFoods(keywords, matchAll);
+    bool matchAll = (matchChoice == 1 || matchChoice == 3);
+    bool fuzzy = (matchChoice == 3 || matchChoice == 4);
+    auto search = [&](const std::string& cursor) {
+        return fuzzy ? foodDb->fuzzySearch(keywords, matchAll, SEARCH_PAGE_SIZE, cursor)
+                     : foodDb->rankedSearch(keywords, matchAll, SEARCH_PAGE_SIZE, cursor);
+    };
+    auto page = search("");
     
     std::cout << "\n===== Search Results =====\n";
-    if (results.empty()) {
+    if (page.results.empty() && !fuzzy) {
+        // Probably a misspelling; fall back to similar spellings
+        fuzzy = true;
+        page = search("");
+        if (!page.results.empty()) {
+            std::cout << "No exact matches. Foods with similar spelling:\n";
+        }
+    }
+    if (page.results.empty()) {
         std::cout << "No matching foods found.\n";
         return;
     }
     
-    for (size_t i = 0; i < results.size(); ++i) {
-        std::cout << i + 1 << ". " << results[i]->toString() << "\n";
+    size_t shown = 0;
+    while (true) {
+        {
+            TextWriter out(&std::cout);
+            for (const auto& result : page.results) {
+                out << ++shown << ". ";
+                result.food->describeTo(out);
+                out << "\n";
+            }
+        }
+        if (page.nextCursor.empty()) {
+            break;
+        }
+        
+        std::cout << "Show more results? (y/n): ";
+        std::string more;
+        std::getline(std::cin, more);
+        if (more != "y" && more != "Y") {
+            break;
+        }
+        page = search(page.nextCursor);
     }
 }
 
@@ -177,14 +278,19 @@ void DietManagerApp::addBasicFood() {
     std::cin >> calories;
     std::cin.ignore();
     
-    auto food = std::make_shared<BasicFood>(identifier, keywords, calories);
+    NutrientVector nutrients;
+    nutrients.set(Nutrient::Calories, calories);
+    std::cout << "Enter other nutrients as name=value (e.g. protein=3,fat=1.5), or leave blank: ";
+    std::string nutrientsStr;
+    std::getline(std::cin, nutrientsStr);
+    parseNutrientList(nutrientsStr, nutrients);
+    
+    auto food = foodDb->createBasicFood(identifier, keywords, nutrients);
     auto command = std::make_shared<AddFoodToDbCommand>(foodDb, food);
     // undoManager.executeCommand(command);
-    if (undoManager.executeCommand(command)) {
+    if (runCommand(command)) {
         // saveData();
         std::cout << "Basic food added successfully.\n";
-    } else {
-        std::cout << "Failed to add food.\n";
     }
 }
 
@@ -220,30 +326,17 @@ void DietManagerApp::createCompositeFood() {
     bool addingComponents = true;
     
     while (addingComponents) {
-        // Show available foods
-        auto foods = foodDb->getAllFoods();
-        std::cout << "\nAvailable Foods:\n";
-        for (size_t i = 0; i < foods.size(); ++i) {
-            std::cout << i + 1 << ". " << foods[i]->getIdentifier() << "\n";
-        }
-        
-        int foodIndex;
-        std::cout << "Select food number (0 to finish): ";
-        std::cin >> foodIndex;
-        std::cin.ignore();
-        
-        if (foodIndex == 0) {
+        const Food* component = selectFoodByPrefix("\nType the start of a component food (empty to finish): ");
+        if (!component) {
             addingComponents = false;
-        } else if (foodIndex >= 1 && foodIndex <= static_cast<int>(foods.size())) {
+        } else {
             double servings;
             std::cout << "Enter number of servings: ";
             std::cin >> servings;
             std::cin.ignore();
             
-            components.push_back(FoodComponent(foods[foodIndex - 1], servings));
+            components.push_back(FoodComponent(component, servings));
             std::cout << "Component added.\n";
-        } else {
-            std::cout << "Invalid food number.\n";
         }
     }
     
@@ -252,21 +345,140 @@ void DietManagerApp::createCompositeFood() {
         return;
     }
     
-    auto food = std::make_shared<CompositeFood>(identifier, keywords, components);
+    auto food = foodDb->createCompositeFood(identifier, keywords, components);
     auto command = std::make_shared<AddFoodToDbCommand>(foodDb, food);
     // undoManager.executeCommand(command);
-    if (undoManager.executeCommand(command)) {
+    if (runCommand(command)) {
         // saveData();
         std::cout << "Composite food created successfully.\n";
-    } else {
-        std::cout << "Failed to create composite food.\n";
+    }
+}
+
+void DietManagerApp::removeFoodFromDb() {
+    std::cout << "\n===== Remove Food =====\n";
+    
+    const Food* food = selectFoodByPrefix("Type the start of the food to remove (empty to cancel): ");
+    if (!food) {
+        return;
+    }
+    
+    RemovePolicy policy = RemovePolicy::Block;
+    auto users = foodDb->getAllDependents(food);
+    if (!users.empty()) {
+        std::cout << food->getIdentifier() << " is used by:\n";
+        for (const Food* user : users) {
+            std::cout << "  - " << user->getIdentifier() << "\n";
+        }
+        std::cout << "Remove these composite foods too? (y/n): ";
+        std::string answer;
+        std::getline(std::cin, answer);
+        if (answer != "y" && answer != "Y") {
+            std::cout << "Food not removed.\n";
+            return;
+        }
+        policy = RemovePolicy::Cascade;
+    }
+    
+    auto command = std::make_shared<RemoveFoodFromDbCommand>(foodDb, food->getIdentifier(), policy);
+    runCommand(command);
+}
+
+void DietManagerApp::editFood() {
+    std::cout << "\n===== Edit Food =====\n";
+    
+    const Food* food = selectFoodByPrefix("Type the start of the food to edit (empty to cancel): ");
+    if (!food) {
+        return;
+    }
+    if (food->getKind() != FoodKind::Basic) {
+        std::cout << "Composite foods change when their components are edited.\n";
+        return;
+    }
+    
+    const NutrientVector& current = static_cast<const BasicFood*>(food)->getNutrients();
+    NutrientVector nutrients = current;
+    while (true) {
+        std::cout << "Enter calories per serving (blank keeps " << nutrients.get(Nutrient::Calories) << "): ";
+        std::string caloriesStr;
+        if (!std::getline(std::cin, caloriesStr)) {
+            return;
+        }
+        if (caloriesStr.find_first_not_of(" \t") == std::string::npos) {
+            break;
+        }
+        std::istringstream caloriesIn(caloriesStr);
+        double calories;
+        if (caloriesIn >> calories && (caloriesIn >> std::ws).eof()) {
+            nutrients.set(Nutrient::Calories, calories);
+            break;
+        }
+        std::cout << "Invalid number, try again.\n";
+    }
+    std::cout << "Enter nutrients to change as name=value (e.g. protein=3,fat=1.5), or leave blank: ";
+    std::string nutrientsStr;
+    std::getline(std::cin, nutrientsStr);
+    parseNutrientList(nutrientsStr, nutrients);
+    
+    // Checked first: creating the replacement uses up a version number
+    if (nutrients == current) {
+        std::cout << "No changes made.\n";
+        return;
+    }
+    auto replacement = foodDb->createBasicFood(food->getIdentifier(), food->getKeywords(), nutrients);
+    size_t users = foodDb->getAllDependents(food).size();
+    auto command = std::make_shared<UpdateFoodCommand>(foodDb, food, replacement);
+    if (runCommand(command)) {
+        std::cout << "Food updated; entries already logged keep the old values.\n";
+        if (users > 0) {
+            std::cout << users << " composite food(s) using it were updated too.\n";
+        }
+    }
+}
+
+const Food* DietManagerApp::selectFoodByPrefix(const std::string& prompt) {
+    while (true) {
+        std::cout << prompt;
+        std::string prefix;
+        if (!std::getline(std::cin, prefix)) {
+            return nullptr;
+        }
+        prefix.erase(0, prefix.find_first_not_of(" \t"));
+        prefix.erase(prefix.find_last_not_of(" \t") + 1);
+        if (prefix.empty()) {
+            return nullptr;
+        }
+        
+        auto completions = foodDb->autocomplete(prefix, SEARCH_PAGE_SIZE);
+        if (completions.empty()) {
+            std::cout << "No foods start with \"" << prefix << "\".\n";
+            continue;
+        }
+        
+        for (size_t i = 0; i < completions.size(); ++i) {
+            std::cout << i + 1 << ". " << completions[i]->getIdentifier() << " ("
+                    << completions[i]->getCaloriesPerServing() << " calories per serving)\n";
+        }
+        int foodIndex;
+        std::cout << "Select food number (0 to type again): ";
+        std::cin >> foodIndex;
+        std::cin.ignore();
+        
+        if (foodIndex >= 1 && foodIndex <= static_cast<int>(completions.size())) {
+            return completions[foodIndex - 1];
+        }
+        if (foodIndex != 0) {
+            std::cout << "Invalid food number.\n";
+        }
     }
 }
 
 void DietManagerApp::logFoods() {
     while (true) {
         std::cout << "\n===== Log Foods for " << log.getCurrentDate() << " =====\n";
-        std::cout << log.getCurrentDayLog().toString();
+        {
+            TextWriter out(&std::cout);
+            log.getCurrentDayLog().describeTo(out);
+        }
         std::cout << "\n1. Add Food to Log\n";
         std::cout << "2. Remove Food from Log\n";
         std::cout << "3. Back to Main Menu\n";
@@ -288,31 +500,38 @@ void DietManagerApp::logFoods() {
 void DietManagerApp::addFoodToLog() {
     std::cout << "\n===== Add Food to Log =====\n";
     
-    // Show available foods or search
-    std::cout << "1. Select from all foods\n";
+    // Type a name, search or pick a frequent food
+    std::cout << "1. Type a food name\n";
     std::cout << "2. Search for food\n";
+    std::cout << "3. Select from frequent foods\n";
     std::cout << "Enter choice: ";
     
     int choice;
     std::cin >> choice;
     std::cin.ignore();
     
-    std::vector<std::shared_ptr<Food>> foods;
+    std::vector<const Food*> foods;
+    const Food* food = nullptr;
+    // Keyword searches list a page at a time; nextCursor continues them
+    std::vector<std::string> keywords;
+    bool matchAll = false;
+    std::string nextCursor;
     
     if (choice == 1) {
-        foods = foodDb->getAllFoods();
+        food = selectFoodByPrefix("Type the start of a food name (empty to cancel): ");
+        if (!food) {
+            return;
+        }
     } else if (choice == 2) {
         std::cout << "Enter keywords (comma separated): ";
         std::string keywordsStr;
         std::getline(std::cin, keywordsStr);
         
-        std::vector<std::string> keywords;
         std::istringstream iss(keywordsStr);
         std::string keyword;
         while (std::getline(iss, keyword, ',')) {
             keyword.erase(0, keyword.find_first_not_of(" \t"));
             keyword.erase(keyword.find_last_not_of(" \t") + 1);
-            std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
             if (!keyword.empty()) {
                 keywords.push_back(keyword);
             }
@@ -323,32 +542,59 @@ void DietManagerApp::addFoodToLog() {
         std::cin >> matchChoice;
         std::cin.ignore();
         
-        bool matchAll = (matchChoice == 1);
-        foods = foodDb->findFoods(keywords, matchAll);
+        matchAll = (matchChoice == 1);
+        auto page = foodDb->rankedSearch(keywords, matchAll, SEARCH_PAGE_SIZE);
+        for (const auto& result : page.results) {
+            foods.push_back(result.food);
+        }
+        nextCursor = page.nextCursor;
+    } else if (choice == 3) {
+        // Straight from the usage ranking, no database scan
+        for (const auto& id : usageStats.getFavorites(SEARCH_PAGE_SIZE)) {
+            const Food* food = foodDb->getFood(id);
+            if (food) {
+                foods.push_back(food);
+            }
+        }
     } else {
         std::cout << "Invalid choice.\n";
         return;
     }
     
-    if (foods.empty()) {
-        std::cout << "No foods available.\n";
-        return;
-    }
-    
-    std::cout << "\nAvailable Foods:\n";
-    for (size_t i = 0; i < foods.size(); ++i) {
-        std::cout << i + 1 << ". " << foods[i]->getIdentifier() << " (" 
-                << foods[i]->getCaloriesPerServing() << " calories per serving)\n";
-    }
-    
-    int foodIndex;
-    std::cout << "Select food number: ";
-    std::cin >> foodIndex;
-    std::cin.ignore();
-    
-    if (foodIndex < 1 || foodIndex > static_cast<int>(foods.size())) {
-        std::cout << "Invalid food number.\n";
-        return;
+    if (!food) {
+        if (foods.empty()) {
+            std::cout << "No foods available.\n";
+            return;
+        }
+        
+        std::cout << "\nAvailable Foods:\n";
+        size_t listed = 0;
+        int foodIndex;
+        while (true) {
+            // Numbers continue across pages, so earlier ones stay selectable
+            for (; listed < foods.size(); ++listed) {
+                std::cout << listed + 1 << ". " << foods[listed]->getIdentifier() << " (" 
+                        << foods[listed]->getCaloriesPerServing() << " calories per serving)\n";
+            }
+            
+            std::cout << (nextCursor.empty() ? "Select food number: " : "Select food number (0 for more results): ");
+            std::cin >> foodIndex;
+            std::cin.ignore();
+            if (foodIndex != 0 || nextCursor.empty()) {
+                break;
+            }
+            auto page = foodDb->rankedSearch(keywords, matchAll, SEARCH_PAGE_SIZE, nextCursor);
+            for (const auto& result : page.results) {
+                foods.push_back(result.food);
+            }
+            nextCursor = page.nextCursor;
+        }
+        
+        if (foodIndex < 1 || foodIndex > static_cast<int>(foods.size())) {
+            std::cout << "Invalid food number.\n";
+            return;
+        }
+        food = foods[foodIndex - 1];
     }
     
     double servings;
@@ -356,10 +602,11 @@ void DietManagerApp::addFoodToLog() {
     std::cin >> servings;
     std::cin.ignore();
     
-    auto command = std::make_shared<AddFoodCommand>(log, foods[foodIndex - 1], servings);
-    undoManager.executeCommand(command);
-    // saveData();
-    std::cout << "Food added to log.\n";
+    auto command = std::make_shared<AddFoodCommand>(log, food, servings, &usageStats);
+    if (runCommand(command)) {
+        // saveData();
+        std::cout << "Food added to log.\n";
+    }
 }
 
 void DietManagerApp::removeFoodFromLog() {
@@ -372,8 +619,13 @@ void DietManagerApp::removeFoodFromLog() {
     }
     
     std::cout << "Current Entries:\n";
-    for (size_t i = 0; i < entries.size(); ++i) {
-        std::cout << i + 1 << ". " << entries[i].toString() << "\n";
+    {
+        TextWriter out(&std::cout);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            out << i + 1 << ". ";
+            entries[i].describeTo(out);
+            out << "\n";
+        }
     }
     
     int entryIndex;
@@ -386,10 +638,11 @@ void DietManagerApp::removeFoodFromLog() {
         return;
     }
     
-    auto command = std::make_shared<RemoveFoodCommand>(log, entryIndex - 1);
-    undoManager.executeCommand(command);
-    // saveData();
-    std::cout << "Entry removed from log.\n";
+    auto command = std::make_shared<RemoveFoodCommand>(log, entryIndex - 1, &usageStats);
+    if (runCommand(command)) {
+        // saveData();
+        std::cout << "Entry removed from log.\n";
+    }
 }
 
 void DietManagerApp::manageProfile() {
@@ -449,20 +702,20 @@ void DietManagerApp::editBasicInfo() {
     std::cin >> genderChoice;
     Gender gender = (genderChoice == 2) ? Gender::Female : Gender::Male;
     auto genderCommand = std::make_shared<SetGenderCommand>(profile, gender);
-    undoManager.executeCommand(genderCommand);
+    runCommand(genderCommand);
     
     double height;
     std::cout << "Enter Height (cm): ";
     std::cin >> height;
     auto heightCommand = std::make_shared<SetHeightCommand>(profile, height);
-    undoManager.executeCommand(heightCommand);
+    runCommand(heightCommand);
     
     int age;
     std::cout << "Enter Age: ";
     std::cin >> age;
     std::cin.ignore();
     auto ageCommand = std::make_shared<SetAgeCommand>(profile, age);
-    undoManager.executeCommand(ageCommand);
+    runCommand(ageCommand);
 
     std::cout << "Basic information updated.\n";
 }
@@ -478,7 +731,7 @@ void DietManagerApp::updateWeight() {
     std::cin.ignore();
     
     auto command = std::make_shared<SetWeightCommand>(profile, log.getCurrentDate(), weight);
-    undoManager.executeCommand(command);
+    runCommand(command);
 
     // saveData();
 
@@ -505,7 +758,7 @@ void DietManagerApp::updateActivityLevel() {
     
     ActivityLevel level = static_cast<ActivityLevel>(choice - 1);
     auto command = std::make_shared<SetActivityLevelCommand>(profile, log.getCurrentDate(), level);
-    undoManager.executeCommand(command);
+    runCommand(command);
 
     // saveData();
 
@@ -525,13 +778,13 @@ void DietManagerApp::changeCalculator() {
     if (choice == 1) {
         auto calculatorPtr = std::make_shared<HarrisBenedictCalculator>();
         auto command = std::make_shared<SetCalculatorCommand>(profile, calculatorPtr);
-        undoManager.executeCommand(command);
+        runCommand(command);
         // saveData();
         std::cout << "Calculator changed to Harris-Benedict Equation.\n";
     } else if (choice == 2) {
         auto calculatorPtr = std::make_shared<MifflinStJeorCalculator>();
         auto command = std::make_shared<SetCalculatorCommand>(profile, calculatorPtr);
-        undoManager.executeCommand(command);
+        runCommand(command);
         // saveData();
         std::cout << "Calculator changed to Mifflin-St Jeor Equation.\n";
     } else {
@@ -562,7 +815,9 @@ void DietManagerApp::selectDate() {
             return;
         }
     } else if (choice == 2) {
-        auto dates = log.getAllDates();
+        // Points at the log's own date strings; nothing here pages days in
+        std::vector<const std::string*> dates;
+        log.forEachDate([&dates](const std::string& date) { dates.push_back(&date); });
         if (dates.empty()) {
             std::cout << "No dates available in log.\n";
             return;
@@ -570,7 +825,7 @@ void DietManagerApp::selectDate() {
         
         std::cout << "Available Dates:\n";
         for (size_t i = 0; i < dates.size(); ++i) {
-            std::cout << i + 1 << ". " << dates[i] << "\n";
+            std::cout << i + 1 << ". " << *dates[i] << "\n";
         }
         
         int dateIndex;
@@ -583,14 +838,14 @@ void DietManagerApp::selectDate() {
             return;
         }
         
-        newDate = dates[dateIndex - 1];
+        newDate = *dates[dateIndex - 1];
     } else {
         std::cout << "Invalid choice.\n";
         return;
     }
     
     auto command = std::make_shared<ChangeDateCommand>(log, newDate);
-    undoManager.executeCommand(command);
+    runCommand(command);
     std::cout << "Date changed to " << newDate << ".\n";
 }
 
@@ -600,13 +855,100 @@ void DietManagerApp::saveData() {
     bool foodDbSaved = foodDb->saveDatabase();
     bool logSaved = log.saveLog();
     bool profileSaved = profile.saveProfile();
+    bool usageSaved = usageStats.save();
     
-    if (foodDbSaved && logSaved && profileSaved) {
+    if (foodDbSaved && logSaved && profileSaved && usageSaved) {
+        // The saved files are the new snapshot, so the command tail is no longer needed
+        commandLog.checkpoint();
         std::cout << "All data saved successfully.\n";
     } else {
         std::cout << "Some data could not be saved.\n";
-        if (!foodDbSaved) std::cout << "- Food database not saved.\n";
-        if (!logSaved) std::cout << "- Daily log not saved.\n";
-        if (!profileSaved) std::cout << "- Profile not saved.\n";
+        if (!foodDbSaved) std::cout << "- Could not open database file for writing.\n";
+        if (!logSaved) std::cout << "- Could not open log file for writing.\n";
+        if (!profileSaved) std::cout << "- Could not open profile file for writing.\n";
+        if (!usageSaved) std::cout << "- Could not open usage file for writing.\n";
+    }
+}
+void DietManagerApp::showMetrics() {
+    std::cout << "\n===== Metrics =====\n";
+    if (!Metrics::isEnabled()) {
+        std::cout << "Metrics are disabled in this build (configure with -DYADA_ENABLE_METRICS=ON).\n";
+        return;
+    }
+    
+    {
+        TextWriter out(&std::cout);
+        Metrics::getInstance()->writeText(out);
+    }
+    
+    std::cout << "Write metrics to metrics.json? (y/n): ";
+    std::string answer;
+    std::getline(std::cin, answer);
+    if (answer == "y" || answer == "Y") {
+        std::ofstream file("metrics.json");
+        if (!file) {
+            std::cout << "Could not open metrics.json for writing.\n";
+            return;
+        }
+        TextWriter out(&file);
+        Metrics::getInstance()->writeJson(out);
+        std::cout << "Metrics written to metrics.json.\n";
+    }
+}
+
+void DietManagerApp::showReports() {
+    while (true) {
+        std::cout << "\n===== Reports =====\n";
+        std::cout << "1. Show Trend Report\n";
+        std::cout << "2. Export Daily Report (CSV)\n";
+        std::cout << "3. Export Full Report (JSON)\n";
+        std::cout << "4. Back to Main Menu\n";
+        std::cout << "Enter choice: ";
+        
+        int choice;
+        if (!(std::cin >> choice)) {
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            std::cout << "Invalid input. Please enter a number.\n";
+            continue;
+        }
+        std::cin.ignore();
+        if (choice == 4) {
+            return;
+        }
+        if (choice < 1 || choice > 3) {
+            std::cout << "Invalid choice. Try again.\n";
+            continue;
+        }
+        
+        Report report = ReportEngine(log, profile).build();
+        if (choice == 1) {
+            std::cout << "\n";
+            TextWriter out(&std::cout);
+            ReportEngine::writeText(report, out);
+            continue;
+        }
+        
+        std::string defaultFile = choice == 2 ? "report.csv" : "report.json";
+        std::cout << "Enter file name (default " << defaultFile << "): ";
+        std::string fileName;
+        std::getline(std::cin, fileName);
+        if (fileName.empty()) {
+            fileName = defaultFile;
+        }
+        
+        std::ofstream file(fileName);
+        if (!file) {
+            std::cout << "Could not open " << fileName << " for writing.\n";
+            continue;
+        }
+        TextWriter out(&file);
+        if (choice == 2) {
+            ReportEngine::writeCsv(report, out);
+        } else {
+            ReportEngine::writeJson(report, out);
+        }
+        out.flush();
+        std::cout << "Report written to " << fileName << ".\n";
     }
-}
\ No newline at end of file
+}
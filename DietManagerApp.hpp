@@ -5,7 +5,9 @@
 #include "DailyLog.hpp"
 #include "DietProfile.hpp"
 #include "Command.hpp"
+#include "CommandLog.hpp"
 #include "FoodTracker.hpp"
+#include "ReportEngine.hpp"
 #include <iostream>
 #include <string>
 #include <limits>
@@ -14,10 +16,15 @@
 // Main application class
 class DietManagerApp {
 private:
+    // Number of ranked search results shown at a time
+    static const size_t SEARCH_PAGE_SIZE = 10;
+    
     FoodDatabase* foodDb;
     DailyLog log;
     DietProfile profile;
     UndoManager undoManager;
+    CommandLog commandLog;
+    FoodUsageStats usageStats;
     FoodTracker tracker;
     bool running;
     
@@ -27,6 +34,8 @@ private:
     void searchFoods();
     void addBasicFood();
     void createCompositeFood();
+    void removeFoodFromDb();
+    void editFood();
     void logFoods();
     void addFoodToLog();
     void removeFoodFromLog();
@@ -38,6 +47,14 @@ private:
     void changeCalculator();
     void selectDate();
     void saveData();
+    void showMetrics();
+    void showReports();
+    void recoverSession();
+    // Lets the user type the start of a food name and pick a completion;
+    // nullptr if they enter an empty line
+    const Food* selectFoodByPrefix(const std::string& prompt);
+    // Executes through the undo manager and reports the action
+    bool runCommand(std::shared_ptr<Command> command);
     
 public:
     DietManagerApp();
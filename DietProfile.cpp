@@ -1,13 +1,21 @@
 #include "DietProfile.hpp"
+#include "Metrics.hpp"
+#include <iterator>
 
 DietProfile::DietProfile() 
     : gender(Gender::Male), heightCm(170), age(30), 
       calculator(std::make_shared<HarrisBenedictCalculator>()),
-      profileFile("profile.txt") {
+      profileFile("profile.txt"), revision(0) {
     // Initialize with default values
     std::string today = "2023-01-01"; // Default date for initialization
     weightsByDate[today] = 70.0;
     activityLevelsByDate[today] = ActivityLevel::ModeratelyActive;
+    lastChange = ProfileChange{ProfileChangeKind::Reloaded, ""};
+}
+
+void DietProfile::recordChange(ProfileChangeKind kind, const std::string& date) {
+    ++revision;
+    lastChange = ProfileChange{kind, date};
 }
 
 void DietProfile::setProfileFile(const std::string& file) {
@@ -16,6 +24,7 @@ void DietProfile::setProfileFile(const std::string& file) {
 
 void DietProfile::setGender(Gender g) {
     gender = g;
+    recordChange(ProfileChangeKind::BasicInfo, "");
     notifyObservers();
 }
 
@@ -25,6 +34,7 @@ Gender DietProfile::getGender() const {
 
 void DietProfile::setHeight(double h) {
     heightCm = h;
+    recordChange(ProfileChangeKind::BasicInfo, "");
     notifyObservers();
 }
 
@@ -34,6 +44,7 @@ double DietProfile::getHeight() const {
 
 void DietProfile::setAge(int a) {
     age = a;
+    recordChange(ProfileChangeKind::BasicInfo, "");
     notifyObservers();
 }
 
@@ -43,58 +54,37 @@ int DietProfile::getAge() const {
 
 void DietProfile::setWeight(const std::string& date, double weight) {
     weightsByDate[date] = weight;
+    recordChange(ProfileChangeKind::Weight, date);
     notifyObservers();
 }
 
 double DietProfile::getWeight(const std::string& date) const {
-    // Try to get weight for specific date
-    auto it = weightsByDate.find(date);
-    if (it != weightsByDate.end()) {
-        return it->second;
-    }
-    
-    // If not found, find the most recent date before the given date
-    double weight = 70.0; // Default weight
-    std::string mostRecentDate = "";
-    
-    for (const auto& pair : weightsByDate) {
-        if (pair.first <= date && (mostRecentDate.empty() || pair.first > mostRecentDate)) {
-            mostRecentDate = pair.first;
-            weight = pair.second;
-        }
+    // The entry for the date, or else the most recent one before it
+    auto next = weightsByDate.upper_bound(date);
+    if (next == weightsByDate.begin()) {
+        return 70.0; // Default weight
     }
-    
-    return weight;
+    return std::prev(next)->second;
 }
 
 void DietProfile::setActivityLevel(const std::string& date, ActivityLevel level) {
     activityLevelsByDate[date] = level;
+    recordChange(ProfileChangeKind::ActivityLevel, date);
     notifyObservers();
 }
 
 ActivityLevel DietProfile::getActivityLevel(const std::string& date) const {
-    // Try to get activity level for specific date
-    auto it = activityLevelsByDate.find(date);
-    if (it != activityLevelsByDate.end()) {
-        return it->second;
-    }
-    
-    // If not found, find the most recent date before the given date
-    ActivityLevel level = ActivityLevel::ModeratelyActive; // Default
-    std::string mostRecentDate = "";
-    
-    for (const auto& pair : activityLevelsByDate) {
-        if (pair.first <= date && (mostRecentDate.empty() || pair.first > mostRecentDate)) {
-            mostRecentDate = pair.first;
-            level = pair.second;
-        }
+    // The entry for the date, or else the most recent one before it
+    auto next = activityLevelsByDate.upper_bound(date);
+    if (next == activityLevelsByDate.begin()) {
+        return ActivityLevel::ModeratelyActive; // Default
     }
-    
-    return level;
+    return std::prev(next)->second;
 }
 
 void DietProfile::setCalculator(std::shared_ptr<TargetCalorieCalculator> calc) {
     calculator = calc;
+    recordChange(ProfileChangeKind::Calculator, "");
     notifyObservers();
 }
 
@@ -108,9 +98,10 @@ double DietProfile::getTargetCalories(const std::string& date) const {
 }
 
 bool DietProfile::loadProfile() {
+    YADA_TIME_SCOPE(LoadProfile);
+    recordChange(ProfileChangeKind::Reloaded, "");
     std::ifstream file(profileFile);
     if (!file.is_open()) {
-        std::cout << "Could not open profile file. Creating a new one when saving." << std::endl;
         return false;
     }
     
@@ -130,10 +121,9 @@ bool DietProfile::loadProfile() {
         heightCm = std::stod(heightStr);
         age = std::stoi(ageStr);
         
-        if (calculatorStr == "Harris-Benedict Equation") {
-            calculator = std::make_shared<HarrisBenedictCalculator>();
-        } else if (calculatorStr == "Mifflin-St Jeor Equation") {
-            calculator = std::make_shared<MifflinStJeorCalculator>();
+        auto loaded = TargetCalorieCalculator::createByName(calculatorStr);
+        if (loaded) {
+            calculator = loaded;
         }
     }
     
@@ -177,9 +167,9 @@ bool DietProfile::loadProfile() {
 }
 
 bool DietProfile::saveProfile() {
+    YADA_TIME_SCOPE(SaveProfile);
     std::ofstream file(profileFile);
     if (!file.is_open()) {
-        std::cout << "Could not open profile file for writing." << std::endl;
         return false;
     }
     
@@ -204,4 +194,24 @@ bool DietProfile::saveProfile() {
     
     file.close();
     return true;
-}
\ No newline at end of file
+}
+
+uint64_t DietProfile::getRevision() const {
+    return revision;
+}
+
+const ProfileChange& DietProfile::getLastChange() const {
+    return lastChange;
+}
+
+std::string DietProfile::getNextChangeDate(const ProfileChange& change) const {
+    if (change.kind == ProfileChangeKind::Weight) {
+        auto next = weightsByDate.upper_bound(change.date);
+        return next != weightsByDate.end() ? next->first : "";
+    }
+    if (change.kind == ProfileChangeKind::ActivityLevel) {
+        auto next = activityLevelsByDate.upper_bound(change.date);
+        return next != activityLevelsByDate.end() ? next->first : "";
+    }
+    return "";
+}
@@ -6,10 +6,25 @@
 #include "Calculator.hpp"
 #include <string>
 #include <map>
+#include <cstdint>
 #include <memory>
 #include <fstream>
 #include <sstream>
-#include <iostream>
+
+// What the last notification was about; Weight and ActivityLevel changes
+// only affect targets from their date up to the next entry of the same kind
+enum class ProfileChangeKind {
+    Weight,
+    ActivityLevel,
+    BasicInfo,
+    Calculator,
+    Reloaded
+};
+
+struct ProfileChange {
+    ProfileChangeKind kind;
+    std::string date;
+};
 
 // User's Diet Profile
 class DietProfile : public Subject {
@@ -21,6 +36,10 @@ private:
     std::map<std::string, ActivityLevel> activityLevelsByDate;
     std::shared_ptr<TargetCalorieCalculator> calculator;
     std::string profileFile;
+    uint64_t revision;
+    ProfileChange lastChange;
+    
+    void recordChange(ProfileChangeKind kind, const std::string& date);
     
 public:
     DietProfile();
@@ -49,6 +68,12 @@ public:
     
     bool loadProfile();
     bool saveProfile();
+    
+    uint64_t getRevision() const;
+    const ProfileChange& getLastChange() const;
+    // First date after `date` with its own entry of the changed kind, or ""
+    // if the change applies to all later dates
+    std::string getNextChangeDate(const ProfileChange& change) const;
 };
 
 #endif // DIET_PROFILE_HPP
\ No newline at end of file
@@ -1,17 +1,65 @@
 #include "Food.hpp"
+#include "TextNormalizer.hpp"
 
 // Food class implementation
-Food::Food(const std::string& id, const std::vector<std::string>& keys) 
-    : identifier(id), keywords(keys) {}
+Food::Food(FoodKind k, const std::string& id, const std::vector<std::string>& keys) : kind(k), version(1) {
+    SymbolTable* symbols = SymbolTable::getInstance();
+    identifier = symbols->intern(id);
+    foldedIdentifier = symbols->getFolded(identifier);
+    keywords.reserve(keys.size());
+    foldedKeywords.reserve(keys.size());
+    for (const auto& key : keys) {
+        keywords.push_back(symbols->intern(key));
+        foldedKeywords.push_back(symbols->getFoldedKeyword(keywords.back()));
+    }
+}
+
+const std::string& Food::getIdentifier() const { return SymbolTable::getInstance()->getString(identifier); }
+
+std::vector<std::string> Food::getKeywords() const {
+    SymbolTable* symbols = SymbolTable::getInstance();
+    std::vector<std::string> result;
+    result.reserve(keywords.size());
+    for (Symbol key : keywords) {
+        result.push_back(symbols->getString(key));
+    }
+    return result;
+}
+
+std::string Food::getReference() const {
+    TextWriter out;
+    writeReference(out);
+    return out.str();
+}
+
+void Food::writeReference(TextWriter& out) const {
+    const std::string& id = getIdentifier();
+    out << id;
+    // An identifier containing '@' always gets a version, so it can't be
+    // mistaken for one
+    if (version > 1 || id.find('@') != std::string::npos) {
+        out << '@' << static_cast<size_t>(version);
+    }
+}
 
-const std::string& Food::getIdentifier() const { return identifier; }
-const std::vector<std::string>& Food::getKeywords() const { return keywords; }
+Symbol Food::getIdentifierSymbol() const { return identifier; }
+const std::vector<Symbol>& Food::getKeywordSymbols() const { return keywords; }
+const std::string& Food::getFoldedIdentifier() const { return SymbolTable::getInstance()->getString(foldedIdentifier); }
+const std::vector<Symbol>& Food::getFoldedKeywordSymbols() const { return foldedKeywords; }
+
+NutrientVector Food::getNutrientsPerServing() const {
+    NutrientVector result;
+    accumulateNutrients(result, 1.0);
+    return result;
+}
 
 bool Food::matchesAllKeywords(const std::vector<std::string>& searchKeys) const {
-    for (const auto& key : searchKeys) {
+    SymbolTable* symbols = SymbolTable::getKeywordTable();
+    for (const auto& searchKey : searchKeys) {
+        std::string key = foldText(searchKey);
         bool found = false;
-        for (const auto& foodKey : keywords) {
-            if (foodKey.find(key) != std::string::npos) {
+        for (Symbol foodKey : foldedKeywords) {
+            if (symbols->getString(foodKey).find(key) != std::string::npos) {
                 found = true;
                 break;
             }
@@ -24,9 +72,43 @@ bool Food::matchesAllKeywords(const std::vector<std::string>& searchKeys) const
 bool Food::matchesAnyKeyword(const std::vector<std::string>& searchKeys) const {
     if (searchKeys.empty()) return true;
     
-    for (const auto& key : searchKeys) {
-        for (const auto& foodKey : keywords) {
-            if (foodKey.find(key) != std::string::npos) {
+    SymbolTable* symbols = SymbolTable::getKeywordTable();
+    for (const auto& searchKey : searchKeys) {
+        std::string key = foldText(searchKey);
+        for (Symbol foodKey : foldedKeywords) {
+            if (symbols->getString(foodKey).find(key) != std::string::npos) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Symbols interned after the masks were built are treated as non-matching
+static bool maskContains(const std::vector<bool>& mask, Symbol symbol) {
+    return symbol < mask.size() && mask[symbol];
+}
+
+bool Food::matchesAllKeywords(const KeywordMasks& keyMasks) const {
+    for (const auto& mask : keyMasks) {
+        bool found = false;
+        for (Symbol foodKey : foldedKeywords) {
+            if (maskContains(mask, foodKey)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+bool Food::matchesAnyKeyword(const KeywordMasks& keyMasks) const {
+    if (keyMasks.empty()) return true;
+    
+    for (const auto& mask : keyMasks) {
+        for (Symbol foodKey : foldedKeywords) {
+            if (maskContains(mask, foodKey)) {
                 return true;
             }
         }
@@ -36,39 +118,67 @@ bool Food::matchesAnyKeyword(const std::vector<std::string>& searchKeys) const {
 
 // BasicFood class implementation
 BasicFood::BasicFood(const std::string& id, const std::vector<std::string>& keys, double cals)
-    : Food(id, keys), calories(cals) {}
+    : Food(FoodKind::Basic, id, keys) {
+    nutrients.set(Nutrient::Calories, cals);
+}
 
-double BasicFood::getCaloriesPerServing() const { return calories; }
+BasicFood::BasicFood(const std::string& id, const std::vector<std::string>& keys, const NutrientVector& n)
+    : Food(FoodKind::Basic, id, keys), nutrients(n) {}
+
+double BasicFood::getCaloriesPerServing() const { return nutrients.get(Nutrient::Calories); }
+
+void BasicFood::accumulateNutrients(NutrientVector& total, double servings) const {
+    total.addScaled(nutrients, servings);
+}
 
 std::string BasicFood::toString() const {
-    std::stringstream ss;
-    ss << identifier << " (";
-    for (size_t i = 0; i < keywords.size(); ++i) {
-        ss << keywords[i];
-        if (i < keywords.size() - 1) ss << ", ";
-    }
-    ss << ") - " << calories << " calories per serving";
-    return ss.str();
+    TextWriter out;
+    writeDescription(out);
+    return out.str();
 }
 
 std::string BasicFood::serialize() const {
-    std::stringstream ss;
-    ss << "BASIC;" << identifier << ";";
+    TextWriter out;
+    writeSerialized(out);
+    return out.str();
+}
+
+// Writes keywords separated by separator
+static void writeKeywords(TextWriter& out, const std::vector<Symbol>& keywords, const char* separator) {
+    SymbolTable* symbols = SymbolTable::getInstance();
     for (size_t i = 0; i < keywords.size(); ++i) {
-        ss << keywords[i];
-        if (i < keywords.size() - 1) ss << ",";
+        out << symbols->getString(keywords[i]);
+        if (i < keywords.size() - 1) out << separator;
+    }
+}
+
+void BasicFood::writeDescription(TextWriter& out) const {
+    out << getIdentifier() << " (";
+    writeKeywords(out, keywords, ", ");
+    out << ") - " << nutrients.get(Nutrient::Calories) << " calories per serving";
+    if (nutrients.hasNonCalorieValues()) {
+        out << " [protein " << nutrients.get(Nutrient::Protein) << "g, fat " << nutrients.get(Nutrient::Fat)
+            << "g, carbs " << nutrients.get(Nutrient::Carbohydrates) << "g]";
+    }
+}
+
+void BasicFood::writeSerialized(TextWriter& out) const {
+    out << "BASIC;" << getIdentifier() << ";";
+    writeKeywords(out, keywords, ",");
+    out << ";" << nutrients.get(Nutrient::Calories);
+    if (nutrients.hasNonCalorieValues()) {
+        out << ";";
+        writeNutrientList(out, nutrients);
     }
-    ss << ";" << calories;
-    return ss.str();
 }
 
 // FoodComponent implementation
-FoodComponent::FoodComponent(std::shared_ptr<Food> f, double s) : food(f), servings(s) {}
+FoodComponent::FoodComponent(const Food* f, double s) : food(f), servings(s) {}
 
 // CompositeFood implementation
 CompositeFood::CompositeFood(const std::string& id, const std::vector<std::string>& keys,
                 const std::vector<FoodComponent>& comps)
-    : Food(id, keys), components(comps) {}
+    : Food(FoodKind::Composite, id, keys), components(comps) {}
 
 double CompositeFood::getCaloriesPerServing() const {
     double totalCalories = 0.0;
@@ -78,34 +188,59 @@ double CompositeFood::getCaloriesPerServing() const {
     return totalCalories;
 }
 
+void CompositeFood::accumulateNutrients(NutrientVector& total, double servings) const {
+    // Components add straight into the caller's accumulator, one vector op each
+    for (const auto& comp : components) {
+        comp.food->accumulateNutrients(total, comp.servings * servings);
+    }
+}
+
 const std::vector<FoodComponent>& CompositeFood::getComponents() const { return components; }
 
 std::string CompositeFood::toString() const {
-    std::stringstream ss;
-    ss << identifier << " (";
-    for (size_t i = 0; i < keywords.size(); ++i) {
-        ss << keywords[i];
-        if (i < keywords.size() - 1) ss << ", ";
-    }
-    ss << ") - " << getCaloriesPerServing() << " calories per serving\n";
-    ss << "Components:\n";
-    for (const auto& comp : components) {
-        ss << "  - " << comp.servings << " serving(s) of " << comp.food->getIdentifier() << "\n";
-    }
-    return ss.str();
+    TextWriter out;
+    writeDescription(out);
+    return out.str();
 }
 
 std::string CompositeFood::serialize() const {
-    std::stringstream ss;
-    ss << "COMPOSITE;" << identifier << ";";
-    for (size_t i = 0; i < keywords.size(); ++i) {
-        ss << keywords[i];
-        if (i < keywords.size() - 1) ss << ",";
+    TextWriter out;
+    writeSerialized(out);
+    return out.str();
+}
+
+void CompositeFood::writeDescription(TextWriter& out) const {
+    out << getIdentifier() << " (";
+    writeKeywords(out, keywords, ", ");
+    out << ") - " << sumComponentCalories() << " calories per serving\n";
+    out << "Components:\n";
+    for (const auto& comp : components) {
+        out << "  - " << comp.servings << " serving(s) of " << comp.food->getIdentifier() << "\n";
     }
-    ss << ";";
+}
+
+void CompositeFood::writeSerialized(TextWriter& out) const {
+    out << "COMPOSITE;" << getIdentifier() << ";";
+    writeKeywords(out, keywords, ",");
+    out << ";";
     for (size_t i = 0; i < components.size(); ++i) {
-        ss << components[i].food->getIdentifier() << ":" << components[i].servings;
-        if (i < components.size() - 1) ss << ",";
+        // Components are pinned to the version this composite was built from
+        components[i].food->writeReference(out);
+        out << ":" << components[i].servings;
+        if (i < components.size() - 1) out << ",";
+    }
+}
+
+double CompositeFood::sumComponentCalories() const {
+    double totalCalories = 0.0;
+    for (const auto& comp : components) {
+        totalCalories += comp.food->calories() * comp.servings;
+    }
+    return totalCalories;
+}
+
+void CompositeFood::addComponentNutrients(NutrientVector& total, double servings) const {
+    for (const auto& comp : components) {
+        comp.food->addNutrients(total, comp.servings * servings);
     }
-    return ss.str();
 }
\ No newline at end of file
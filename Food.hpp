@@ -5,53 +5,117 @@
 #include <vector>
 #include <memory>
 #include <sstream>
+#include <cstdint>
+#include "Nutrients.hpp"
+#include "SymbolTable.hpp"
+#include "TextWriter.hpp"
+
+// Per folded search keyword, the set of keyword table symbols containing it
+// (see SymbolTable::findContaining)
+typedef std::vector<std::vector<bool>> KeywordMasks;
+
+class CompositeFood;
+
+// Concrete type of a Food, used for tag dispatch on hot paths
+enum class FoodKind : uint8_t {
+    Basic,
+    Composite
+};
 
 // Food class - base class for BasicFood and CompositeFood
 class Food {
 protected:
-    std::string identifier;
-    std::vector<std::string> keywords;
+    // Versions are assigned by FoodDatabase
+    friend class FoodDatabase;
+    FoodKind kind;
+    // Foods are immutable; editing one publishes a new version with the same
+    // identifier. Numbered from 1 per identifier.
+    uint32_t version;
+    // Interned in SymbolTable
+    Symbol identifier;
+    std::vector<Symbol> keywords;
+    // Folded forms (see foldText) that all matching runs on; computed once
+    // when the food is created, in the same order as keywords. The folded
+    // keywords are symbols of SymbolTable::getKeywordTable().
+    Symbol foldedIdentifier;
+    std::vector<Symbol> foldedKeywords;
+    
+    Food(FoodKind k, const std::string& id, const std::vector<std::string>& keys);
     
 public:
-    Food(const std::string& id, const std::vector<std::string>& keys);
     virtual ~Food() = default;
     
+    FoodKind getKind() const { return kind; }
+    // nullptr unless this is a CompositeFood; replaces dynamic_cast
+    const CompositeFood* asComposite() const;
+    
     const std::string& getIdentifier() const;
-    const std::vector<std::string>& getKeywords() const;
+    uint32_t getVersion() const { return version; }
+    // "identifier@version", or just the identifier for version 1; resolved
+    // by FoodDatabase::resolveReference()
+    std::string getReference() const;
+    void writeReference(TextWriter& out) const;
+    std::vector<std::string> getKeywords() const;
+    Symbol getIdentifierSymbol() const;
+    const std::vector<Symbol>& getKeywordSymbols() const;
+    const std::string& getFoldedIdentifier() const;
+    // Symbols of SymbolTable::getKeywordTable(), not getInstance()
+    const std::vector<Symbol>& getFoldedKeywordSymbols() const;
     
     virtual double getCaloriesPerServing() const = 0;
+    // Adds this food's nutrients times servings into total
+    virtual void accumulateNutrients(NutrientVector& total, double servings) const = 0;
+    NutrientVector getNutrientsPerServing() const;
     virtual std::string toString() const = 0;
     virtual std::string serialize() const = 0;
     
+    // Non-virtual equivalents of the virtual functions above that switch on
+    // the kind tag. Daily totals, composite walks and saving use these; the
+    // virtual functions remain the public interface.
+    double calories() const;
+    void addNutrients(NutrientVector& total, double servings) const;
+    void describeTo(TextWriter& out) const;
+    void serializeTo(TextWriter& out) const;
+    
+    // Search keys are folded before matching, so case and accents don't matter
     bool matchesAllKeywords(const std::vector<std::string>& searchKeys) const;
     bool matchesAnyKeyword(const std::vector<std::string>& searchKeys) const;
+    bool matchesAllKeywords(const KeywordMasks& keyMasks) const;
+    bool matchesAnyKeyword(const KeywordMasks& keyMasks) const;
 };
 
 // BasicFood class
 class BasicFood : public Food {
 private:
-    double calories;
+    NutrientVector nutrients;
     
 public:
     BasicFood(const std::string& id, const std::vector<std::string>& keys, double cals);
+    BasicFood(const std::string& id, const std::vector<std::string>& keys, const NutrientVector& n);
     
+    const NutrientVector& getNutrients() const { return nutrients; }
     double getCaloriesPerServing() const override;
+    void accumulateNutrients(NutrientVector& total, double servings) const override;
     std::string toString() const override;
     std::string serialize() const override;
+    void writeDescription(TextWriter& out) const;
+    void writeSerialized(TextWriter& out) const;
 };
 
 // FoodComponent class for Composite pattern
 class FoodComponent {
 public:
-    std::shared_ptr<Food> food;
+    const Food* food;
     double servings;
     
-    FoodComponent(std::shared_ptr<Food> f, double s);
+    FoodComponent(const Food* f, double s);
 };
 
 // CompositeFood class
 class CompositeFood : public Food {
 private:
+    // Filled in by FoodDatabase once all referenced foods are loaded
+    friend class FoodDatabase;
     std::vector<FoodComponent> components;
     
 public:
@@ -59,9 +123,50 @@ public:
                  const std::vector<FoodComponent>& comps);
     
     double getCaloriesPerServing() const override;
+    void accumulateNutrients(NutrientVector& total, double servings) const override;
     const std::vector<FoodComponent>& getComponents() const;
     std::string toString() const override;
     std::string serialize() const override;
+    void writeDescription(TextWriter& out) const;
+    void writeSerialized(TextWriter& out) const;
+    
+    double sumComponentCalories() const;
+    void addComponentNutrients(NutrientVector& total, double servings) const;
 };
 
+inline const CompositeFood* Food::asComposite() const {
+    return kind == FoodKind::Composite ? static_cast<const CompositeFood*>(this) : nullptr;
+}
+
+inline double Food::calories() const {
+    if (kind == FoodKind::Basic) {
+        return static_cast<const BasicFood*>(this)->getNutrients().get(Nutrient::Calories);
+    }
+    return static_cast<const CompositeFood*>(this)->sumComponentCalories();
+}
+
+inline void Food::addNutrients(NutrientVector& total, double servings) const {
+    if (kind == FoodKind::Basic) {
+        total.addScaled(static_cast<const BasicFood*>(this)->getNutrients(), servings);
+    } else {
+        static_cast<const CompositeFood*>(this)->addComponentNutrients(total, servings);
+    }
+}
+
+inline void Food::describeTo(TextWriter& out) const {
+    if (kind == FoodKind::Basic) {
+        static_cast<const BasicFood*>(this)->writeDescription(out);
+    } else {
+        static_cast<const CompositeFood*>(this)->writeDescription(out);
+    }
+}
+
+inline void Food::serializeTo(TextWriter& out) const {
+    if (kind == FoodKind::Basic) {
+        static_cast<const BasicFood*>(this)->writeSerialized(out);
+    } else {
+        static_cast<const CompositeFood*>(this)->writeSerialized(out);
+    }
+}
+
 #endif // FOOD_H
\ No newline at end of file
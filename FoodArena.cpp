@@ -0,0 +1,39 @@
+#include "FoodArena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+const size_t FoodArena::BLOCK_SIZE;
+
+FoodArena::FoodArena() : current(nullptr), remaining(0), bytesReserved(0) {}
+
+FoodArena::~FoodArena() {
+    for (Food* object : objects) {
+        object->~Food();
+    }
+}
+
+void* FoodArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    if (!current || padding + size > remaining) {
+        // Oversized objects get a block of their own
+        size_t blockSize = std::max(BLOCK_SIZE, size + alignment);
+        blocks.emplace_back(new char[blockSize]);
+        current = blocks.back().get();
+        remaining = blockSize;
+        bytesReserved += blockSize;
+        padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    }
+    
+    void* memory = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    return memory;
+}
+
+size_t FoodArena::getObjectCount() const {
+    return objects.size();
+}
+
+size_t FoodArena::getBytesReserved() const {
+    return bytesReserved;
+}
@@ -0,0 +1,46 @@
+#ifndef FOOD_ARENA_HPP
+#define FOOD_ARENA_HPP
+
+#include "Food.hpp"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Block allocator that owns Food objects.
+// Foods are placed back to back in large blocks instead of one heap
+// allocation (plus a shared_ptr control block) each, and are destroyed
+// together when the arena is destroyed. Pointers handed out stay valid for
+// the arena's whole lifetime, even after the food leaves the database.
+class FoodArena {
+private:
+    static const size_t BLOCK_SIZE = 256 * 1024;
+    
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* current;
+    size_t remaining;
+    size_t bytesReserved;
+    std::vector<Food*> objects;
+    
+    void* allocate(size_t size, size_t alignment);
+    
+public:
+    FoodArena();
+    ~FoodArena();
+    FoodArena(const FoodArena&) = delete;
+    FoodArena& operator=(const FoodArena&) = delete;
+    
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        objects.push_back(object);
+        return object;
+    }
+    
+    size_t getObjectCount() const;
+    size_t getBytesReserved() const;
+};
+
+#endif // FOOD_ARENA_HPP
@@ -1,9 +1,34 @@
 #include "FoodDatabase.hpp"
+#include "FoodUsageStats.hpp"
+#include "Metrics.hpp"
+#include "TextNormalizer.hpp"
+#include "TaskPool.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <queue>
+#include <unordered_set>
+#include <algorithm>
 
 // Initialize the static instance
 FoodDatabase* FoodDatabase::instance = nullptr;
+const size_t FoodDatabase::SEARCH_SHARD_SIZE;
 
-FoodDatabase::FoodDatabase() : databaseFile("foods.txt") {}
+FoodDatabase::FoodDatabase()
+    : liveCount(0), snapshot(std::make_shared<const FoodMap>()), batchDepth(0), usageStats(nullptr), databaseFile("foods.txt"), generation(0), searchCacheHits(0), searchCacheMisses(0),
+      parallelSearchThreshold(PARALLEL_SEARCH_THRESHOLD), sortedGeneration(static_cast<unsigned long>(-1)),
+      termIndexStale(true) {}
+
+// Parses the "calories[;name=value,...]" tail of a BASIC line
+static NutrientVector parseBasicNutrients(const std::string& text) {
+    NutrientVector nutrients;
+    size_t separator = text.find(';');
+    nutrients.set(Nutrient::Calories, std::stod(text.substr(0, separator)));
+    if (separator != std::string::npos) {
+        parseNutrientList(text.substr(separator + 1), nutrients);
+    }
+    return nutrients;
+}
 
 FoodDatabase* FoodDatabase::getInstance() {
     if (!instance) {
@@ -13,143 +38,1025 @@ FoodDatabase* FoodDatabase::getInstance() {
 }
 
 FoodDatabase::~FoodDatabase() {
-    foods.clear();
+    index.clear();
 }
 
 void FoodDatabase::setDatabaseFile(const std::string& file) {
     databaseFile = file;
 }
 
-bool FoodDatabase::addFood(std::shared_ptr<Food> food) {
-    if (foods.find(food->getIdentifier()) != foods.end()) {
+const Food* FoodDatabase::createBasicFood(const std::string& id, const std::vector<std::string>& keys,
+                                          const NutrientVector& nutrients) {
+    return assignVersion(arena.create<BasicFood>(id, keys, nutrients));
+}
+
+const Food* FoodDatabase::createCompositeFood(const std::string& id, const std::vector<std::string>& keys,
+                                              const std::vector<FoodComponent>& components) {
+    return assignVersion(arena.create<CompositeFood>(id, keys, components));
+}
+
+Food* FoodDatabase::assignVersion(Food* food) {
+    food->version = ++index.insert(food->getIdentifier()).lastVersion;
+    return food;
+}
+
+void FoodDatabase::recordVersion(const Food* food) {
+    FoodRecord& record = index.insert(food->getIdentifier());
+    record.lastVersion = std::max(record.lastVersion, food->getVersion());
+    auto& history = record.versions;
+    auto pos = std::lower_bound(history.begin(), history.end(), food->getVersion(),
+                                [](const Food* a, uint32_t version) { return a->getVersion() < version; });
+    if (pos == history.end() || (*pos)->getVersion() != food->getVersion()) {
+        history.insert(pos, food);
+    }
+}
+
+void FoodDatabase::publish(const FoodMap& map) {
+    if (batchDepth == 0) {
+        std::atomic_store(&snapshot, std::make_shared<const FoodMap>(map));
+    }
+}
+
+// Builds the snapshot from scratch, much cheaper than a set() per food
+void FoodDatabase::publishLive() {
+    std::vector<const Food*> live;
+    live.reserve(liveCount);
+    for (const FoodRecord& record : index) {
+        if (record.live) {
+            live.push_back(record.live);
+        }
+    }
+    publish(FoodMap::fromFoods(live));
+}
+
+void FoodDatabase::beginBatch() {
+    ++batchDepth;
+}
+
+void FoodDatabase::endBatch() {
+    if (batchDepth > 0 && --batchDepth == 0) {
+        publishLive();
+    }
+}
+
+FoodMap FoodDatabase::getSnapshot() const {
+    return *std::atomic_load(&snapshot);
+}
+
+bool FoodDatabase::addFood(const Food* food) {
+    if (getFood(food->getIdentifier())) {
         return false; // Food with this ID already exists
     }
-    foods[food->getIdentifier()] = food;
+    setLive(food);
+    linkComponents(food);
+    recordVersion(food);
+    if (batchDepth == 0) {
+        publish(snapshot->set(food));
+    }
+    ++generation;
+    return true;
+}
+
+void FoodDatabase::replaceFood(const Food* old, const Food* next) {
+    // old keeps its own dependents entry until each user is replaced too
+    unlinkComponents(old);
+    setLive(next);
+    linkComponents(next);
+    recordVersion(next);
+}
+
+void FoodDatabase::setLive(const Food* food) {
+    FoodRecord& record = index.insert(food->getIdentifier());
+    if (!record.live) {
+        ++liveCount;
+    }
+    updateTermIndex(record.live, food);
+    record.live = food;
+}
+
+bool FoodDatabase::updateFood(const Food* food, std::vector<const Food*>* updated) {
+    const Food* old = getFood(food->getIdentifier());
+    if (!old || old == food) {
+        return false;
+    }
+    // Each user comes after the ones it uses, so its components already
+    // have their new versions when it is rebuilt
+    std::vector<const Food*> users = getAllDependents(old);
+    std::unordered_map<const Food*, const Food*> replacements;
+    replacements[old] = food;
+    replaceFood(old, food);
+    // Inside a batch endBatch() builds the snapshot instead
+    bool publishing = batchDepth == 0;
+    FoodMap map = publishing ? snapshot->set(food) : FoodMap();
+    
+    for (const Food* user : users) {
+        std::vector<FoodComponent> components = user->asComposite()->getComponents();
+        for (auto& component : components) {
+            auto replaced = replacements.find(component.food);
+            if (replaced != replacements.end()) {
+                component.food = replaced->second;
+            }
+        }
+        const Food* next = createCompositeFood(user->getIdentifier(), user->getKeywords(), components);
+        replacements[user] = next;
+        replaceFood(user, next);
+        if (publishing) {
+            map = map.set(next);
+        }
+        if (updated) {
+            updated->push_back(next);
+        }
+    }
+    // Readers see the whole change at once
+    publish(map);
+    ++generation;
+    return true;
+}
+
+bool FoodDatabase::restoreFoods(const std::vector<const Food*>& foods) {
+    std::unordered_set<const Food*> replaced;
+    for (const Food* food : foods) {
+        const Food* current = getFood(food->getIdentifier());
+        if (!current) {
+            return false;
+        }
+        replaced.insert(current);
+    }
+    for (const Food* current : replaced) {
+        for (const Food* user : getDependents(current)) {
+            if (!replaced.count(user)) {
+                return false;
+            }
+        }
+    }
+    
+    bool publishing = batchDepth == 0;
+    FoodMap map = publishing ? *snapshot : FoodMap();
+    for (const Food* food : foods) {
+        const Food* current = getFood(food->getIdentifier());
+        if (current == food) {
+            continue;
+        }
+        replaceFood(current, food);
+        if (publishing) {
+            map = map.set(food);
+        }
+    }
+    publish(map);
+    ++generation;
     return true;
 }
 
-std::shared_ptr<Food> FoodDatabase::getFood(const std::string& id) {
-    auto it = foods.find(id);
-    if (it != foods.end()) {
-        return it->second;
+const Food* FoodDatabase::getFoodVersion(const std::string& id, uint32_t version) const {
+    const FoodRecord* record = index.find(id);
+    if (!record) {
+        return nullptr;
+    }
+    const auto& history = record->versions;
+    auto pos = std::lower_bound(history.begin(), history.end(), version,
+                                [](const Food* a, uint32_t v) { return a->getVersion() < v; });
+    return pos != history.end() && (*pos)->getVersion() == version ? *pos : nullptr;
+}
+
+// Splits "identifier@version"; false (id is the whole reference) if it isn't pinned
+static bool splitReference(const std::string& reference, std::string& id, uint32_t& version) {
+    size_t at = reference.rfind('@');
+    if (at != std::string::npos && at + 1 < reference.size() && reference.size() - at <= 10 &&
+        reference.find_first_not_of("0123456789", at + 1) == std::string::npos) {
+        id = reference.substr(0, at);
+        version = static_cast<uint32_t>(std::stoul(reference.substr(at + 1)));
+        return true;
+    }
+    id = reference;
+    return false;
+}
+
+const Food* FoodDatabase::resolveReference(const std::string& reference) const {
+    std::string id;
+    uint32_t version = 1;
+    splitReference(reference, id, version);
+    return getFoodVersion(id, version);
+}
+
+void FoodDatabase::linkComponents(const Food* food) {
+    const CompositeFood* composite = food->asComposite();
+    if (!composite) {
+        return;
+    }
+    for (const auto& component : composite->getComponents()) {
+        auto& users = dependents[component.food];
+        // A component listed twice is still one dependency
+        if (std::find(users.begin(), users.end(), food) == users.end()) {
+            users.push_back(food);
+        }
+    }
+}
+
+void FoodDatabase::unlinkComponents(const Food* food) {
+    const CompositeFood* composite = food->asComposite();
+    if (!composite) {
+        return;
+    }
+    for (const auto& component : composite->getComponents()) {
+        auto found = dependents.find(component.food);
+        if (found == dependents.end()) {
+            continue;
+        }
+        auto& users = found->second;
+        auto it = std::find(users.begin(), users.end(), food);
+        if (it != users.end()) {
+            *it = users.back();
+            users.pop_back();
+        }
+        if (users.empty()) {
+            dependents.erase(found);
+        }
+    }
+}
+
+const std::vector<const Food*>& FoodDatabase::getDependents(const Food* food) const {
+    static const std::vector<const Food*> none;
+    auto found = dependents.find(food);
+    return found != dependents.end() ? found->second : none;
+}
+
+std::vector<const Food*> FoodDatabase::getAllDependents(const Food* food) const {
+    // Depth-first post-order lists every composite after the ones using it;
+    // reversed, each comes after the ones it uses
+    std::vector<const Food*> order;
+    std::unordered_set<const Food*> visited;
+    std::vector<std::pair<const Food*, size_t>> stack(1, std::make_pair(food, size_t(0)));
+    visited.insert(food);
+    while (!stack.empty()) {
+        const std::vector<const Food*>& users = getDependents(stack.back().first);
+        if (stack.back().second < users.size()) {
+            const Food* user = users[stack.back().second++];
+            if (visited.insert(user).second) {
+                stack.push_back(std::make_pair(user, size_t(0)));
+            }
+        } else {
+            order.push_back(stack.back().first);
+            stack.pop_back();
+        }
+    }
+    order.pop_back(); // food itself
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+const Food* FoodDatabase::getFood(const std::string& id) {
+    const FoodRecord* record = index.find(id);
+    return record ? record->live : nullptr;
+}
+
+// Appends the foods in foods[begin, end) that match the keyword masks
+static void matchFoods(const std::vector<const Food*>& foods, size_t begin, size_t end,
+                       const KeywordMasks& keyMasks, bool matchAll, std::vector<const Food*>& results) {
+    for (size_t i = begin; i < end; ++i) {
+        const Food* food = foods[i];
+        if (matchAll ? food->matchesAllKeywords(keyMasks) : food->matchesAnyKeyword(keyMasks)) {
+            results.push_back(food);
+        }
+    }
+}
+
+static std::vector<std::string> foldKeywords(const std::vector<std::string>& keywords) {
+    std::vector<std::string> folded;
+    folded.reserve(keywords.size());
+    for (const auto& keyword : keywords) {
+        folded.push_back(foldText(keyword));
+    }
+    return folded;
+}
+
+std::vector<const Food*> FoodDatabase::findFoods(const std::vector<std::string>& keywords, bool matchAll) {
+    YADA_TIME_SCOPE(FindFoods);
+    return cachedSearch(foldKeywords(keywords), matchAll);
+}
+
+FoodSpan FoodDatabase::viewFoods(const std::vector<std::string>& keywords, bool matchAll) {
+    YADA_TIME_SCOPE(FindFoods);
+    return FoodSpan(cachedSearch(foldKeywords(keywords), matchAll));
+}
+
+const std::vector<const Food*>& FoodDatabase::cachedSearch(const std::vector<std::string>& foldedKeywords, bool matchAll) {
+    // Both match modes are set operations, so order and duplicates don't matter
+    std::vector<std::string> normalized(foldedKeywords);
+    std::sort(normalized.begin(), normalized.end());
+    normalized.erase(std::unique(normalized.begin(), normalized.end()), normalized.end());
+    
+    std::string key = matchAll ? "all" : "any";
+    for (const auto& keyword : normalized) {
+        key += '\x1f';
+        key += keyword;
+    }
+    
+    auto found = searchCacheIndex.find(key);
+    if (found != searchCacheIndex.end()) {
+        if (found->second->generation == generation) {
+            ++searchCacheHits;
+            YADA_COUNT(SearchCacheHit);
+            searchCache.splice(searchCache.begin(), searchCache, found->second);
+            return searchCache.front().results;
+        }
+        searchCache.erase(found->second);
+        searchCacheIndex.erase(found);
+    }
+    ++searchCacheMisses;
+    YADA_COUNT(SearchCacheMiss);
+    
+    // Resolve the keywords against the interned vocabulary in one scan, then test
+    // foods by symbol id instead of searching every food's keyword strings
+    KeywordMasks keyMasks = SymbolTable::getKeywordTable()->findContainingAll(normalized);
+    
+    CachedSearch entry;
+    entry.key = key;
+    entry.generation = generation;
+    const std::vector<const Food*>& all = getSortedFoods();
+    if (all.size() >= parallelSearchThreshold && all.size() > SEARCH_SHARD_SIZE) {
+        size_t shardCount = (all.size() + SEARCH_SHARD_SIZE - 1) / SEARCH_SHARD_SIZE;
+        std::vector<std::vector<const Food*>> shardResults(shardCount);
+        TaskPool::getInstance()->parallelFor(shardCount, [&](size_t shard) {
+            size_t begin = shard * SEARCH_SHARD_SIZE;
+            matchFoods(all, begin, std::min(begin + SEARCH_SHARD_SIZE, all.size()), keyMasks, matchAll,
+                       shardResults[shard]);
+        });
+        // Shards are contiguous runs of the sorted foods, so concatenating
+        // them in shard order gives the same order as a sequential scan
+        size_t total = 0;
+        for (const auto& results : shardResults) total += results.size();
+        entry.results.reserve(total);
+        for (const auto& results : shardResults) {
+            entry.results.insert(entry.results.end(), results.begin(), results.end());
+        }
+    } else {
+        matchFoods(all, 0, all.size(), keyMasks, matchAll, entry.results);
+    }
+    
+    if (searchCache.size() >= SEARCH_CACHE_CAPACITY) {
+        searchCacheIndex.erase(searchCache.back().key);
+        searchCache.pop_back();
+    }
+    searchCache.push_front(std::move(entry));
+    searchCacheIndex[key] = searchCache.begin();
+    return searchCache.front().results;
+}
+
+// Score of a food for a query: each search keyword contributes its best hit
+// on the food's keywords or identifier, plus a bonus for frequently logged foods.
+// Compares folded forms throughout.
+int FoodDatabase::scoreFood(const Food& food, const std::vector<std::string>& foldedKeywords) const {
+    int score = 0;
+    const std::string& id = food.getFoldedIdentifier();
+    
+    for (const auto& key : foldedKeywords) {
+        int best = 0;
+        for (Symbol symbol : food.getFoldedKeywordSymbols()) {
+            const std::string& foodKey = SymbolTable::getKeywordTable()->getString(symbol);
+            if (foodKey == key) {
+                best = std::max(best, 100);
+            } else if (foodKey.compare(0, key.size(), key) == 0) {
+                best = std::max(best, 60);
+            } else if (foodKey.find(key) != std::string::npos) {
+                best = std::max(best, 30);
+            }
+        }
+        
+        if (id == key) {
+            best += 200;
+        } else if (id.compare(0, key.size(), key) == 0) {
+            best += 80;
+        } else if (id.find(key) != std::string::npos) {
+            best += 40;
+        }
+        score += best;
+    }
+    
+    score += std::min(getUsageCount(food.getIdentifier()), 20) * 5;
+    return score;
+}
+
+// Ranking order: higher score first, ties broken by identifier
+static bool ranksBefore(const SearchResult& a, const SearchResult& b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.food->getIdentifier() < b.food->getIdentifier();
+}
+
+// Cursor is "score:identifier" of the last result of the previous page.
+// Callers pass it back to us, so malformed text is rejected, not thrown on.
+static bool parseCursor(const std::string& cursor, int& score, std::string& id) {
+    size_t separator = cursor.find(':');
+    if (separator == std::string::npos || separator == 0) {
+        return false;
+    }
+    std::string number = cursor.substr(0, separator);
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(number.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    score = static_cast<int>(value);
+    id = cursor.substr(separator + 1);
+    return true;
+}
+
+SearchPage FoodDatabase::rankedSearch(const std::vector<std::string>& keywords, bool matchAll,
+                                      size_t limit, const std::string& cursor) {
+    YADA_TIME_SCOPE(RankedSearch);
+    SearchPage page;
+    if (limit == 0) {
+        return page;
+    }
+    
+    int cursorScore = 0;
+    std::string cursorId;
+    bool hasCursor = parseCursor(cursor, cursorScore, cursorId);
+    
+    // Bounded heap holding the best `limit` results; the top is the worst kept
+    std::priority_queue<SearchResult, std::vector<SearchResult>,
+                        bool (*)(const SearchResult&, const SearchResult&)> heap(ranksBefore);
+    size_t remaining = 0;
+    
+    std::vector<std::string> folded = foldKeywords(keywords);
+    for (const auto& food : cachedSearch(folded, matchAll)) {
+        int score = scoreFood(*food, folded);
+        if (hasCursor && (score > cursorScore || (score == cursorScore && food->getIdentifier() <= cursorId))) {
+            continue; // Already returned on an earlier page
+        }
+        
+        ++remaining;
+        SearchResult result{food, score};
+        if (heap.size() < limit) {
+            heap.push(result);
+        } else if (ranksBefore(result, heap.top())) {
+            heap.pop();
+            heap.push(result);
+        }
+    }
+    
+    page.results.resize(heap.size());
+    for (size_t i = heap.size(); i > 0; --i) {
+        page.results[i - 1] = heap.top();
+        heap.pop();
+    }
+    
+    if (remaining > page.results.size()) {
+        const SearchResult& last = page.results.back();
+        page.nextCursor = std::to_string(last.score) + ":" + last.food->getIdentifier();
+    }
+    return page;
+}
+
+// The distinct non-empty terms a food is indexed under
+static void collectTerms(const Food* food, std::vector<std::string>& terms) {
+    const std::string& id = food->getFoldedIdentifier();
+    terms.push_back(id);
+    // Multi-word identifiers ("French Fries") also match word by word
+    if (id.find(' ') != std::string::npos) {
+        std::istringstream words(id);
+        std::string word;
+        while (words >> word) terms.push_back(word);
+    }
+    for (Symbol symbol : food->getFoldedKeywordSymbols()) {
+        terms.push_back(SymbolTable::getKeywordTable()->getString(symbol));
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (!terms.empty() && terms.front().empty()) {
+        terms.erase(terms.begin());
+    }
+}
+
+// Term order, then identifier order: the order of the term indexes and postings
+static bool termFoodBefore(const std::pair<std::string, const Food*>& a,
+                           const std::pair<std::string, const Food*>& b) {
+    if (a.first != b.first) return a.first < b.first;
+    return a.second->getIdentifier() < b.second->getIdentifier();
+}
+
+void FoodDatabase::rebuildTermIndex() {
+    std::vector<std::pair<std::string, const Food*>> termFoods;
+    std::vector<std::string> foodTerms;
+    for (const Food* food : getSortedFoods()) {
+        foodTerms.clear();
+        collectTerms(food, foodTerms);
+        for (const auto& term : foodTerms) {
+            termFoods.push_back(std::make_pair(term, food));
+        }
+    }
+    
+    // Sorted by term, so postings line up with the indexes' term order
+    std::sort(termFoods.begin(), termFoods.end(), termFoodBefore);
+    std::vector<std::string> terms;
+    termPostings.clear();
+    for (const auto& termFood : termFoods) {
+        if (terms.empty() || terms.back() != termFood.first) {
+            terms.push_back(termFood.first);
+            termPostings.push_back(std::vector<const Food*>());
+        }
+        termPostings.back().push_back(termFood.second);
+    }
+    prefixIndex.build(terms);
+    fuzzyIndex.assign(std::move(terms));
+    addedTerms.clear();
+    termIndexStale = false;
+}
+
+void FoodDatabase::updateTermIndex(const Food* removed, const Food* added) {
+    if (termIndexStale) {
+        return;
+    }
+    if (batchDepth > 0 || addedTerms.size() >= TERM_OVERLAY_LIMIT) {
+        // One rebuild on next use is cheaper than many small updates
+        termIndexStale = true;
+        return;
+    }
+    
+    std::vector<std::string> terms;
+    if (removed) {
+        collectTerms(removed, terms);
+        for (const auto& term : terms) {
+            uint32_t position;
+            if (fuzzyIndex.find(term, position)) {
+                auto& posting = termPostings[position];
+                posting.erase(std::remove(posting.begin(), posting.end(), removed), posting.end());
+            } else {
+                auto entry = std::find(addedTerms.begin(), addedTerms.end(), std::make_pair(term, removed));
+                if (entry != addedTerms.end()) {
+                    addedTerms.erase(entry);
+                }
+            }
+        }
+    }
+    if (added) {
+        terms.clear();
+        collectTerms(added, terms);
+        for (const auto& term : terms) {
+            uint32_t position;
+            if (fuzzyIndex.find(term, position)) {
+                auto& posting = termPostings[position];
+                posting.insert(std::lower_bound(posting.begin(), posting.end(), added,
+                                                [](const Food* a, const Food* b) {
+                                                    return a->getIdentifier() < b->getIdentifier();
+                                                }),
+                               added);
+            } else {
+                auto entry = std::make_pair(term, added);
+                addedTerms.insert(std::lower_bound(addedTerms.begin(), addedTerms.end(), entry, termFoodBefore),
+                                  entry);
+            }
+        }
+    }
+}
+
+SearchPage FoodDatabase::fuzzySearch(const std::vector<std::string>& keywords, bool matchAll,
+                                     size_t limit, const std::string& cursor) {
+    YADA_TIME_SCOPE(FuzzySearch);
+    SearchPage page;
+    if (limit == 0) {
+        return page;
+    }
+    if (termIndexStale) {
+        rebuildTermIndex();
+    }
+    
+    std::vector<std::string> terms;
+    for (const auto& keyword : keywords) {
+        terms.push_back(foldText(keyword));
+    }
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    
+    // Per food: summed keyword scores and how many keywords matched
+    static const int DISTANCE_SCORES[] = {100, 60, 30};
+    std::unordered_map<const Food*, std::pair<int, size_t>> hits;
+    std::unordered_map<const Food*, int> best;
+    std::vector<std::pair<uint32_t, size_t>> matches;
+    for (const auto& term : terms) {
+        matches.clear();
+        size_t radius = term.size() <= 2 ? 0 : (term.size() <= 5 ? 1 : 2);
+        fuzzyIndex.findWithin(term, radius, matches);
+        
+        best.clear();
+        for (const auto& match : matches) {
+            for (const Food* food : termPostings[match.first]) {
+                int& score = best[food];
+                score = std::max(score, DISTANCE_SCORES[match.second]);
+            }
+        }
+        // Terms added since the last rebuild
+        for (const auto& termFood : addedTerms) {
+            const std::string& added = termFood.first;
+            if (added.size() > term.size() + radius || term.size() > added.size() + radius) {
+                continue;
+            }
+            size_t distance = FuzzyIndex::editDistance(term, added);
+            if (distance <= radius) {
+                int& score = best[termFood.second];
+                score = std::max(score, DISTANCE_SCORES[distance]);
+            }
+        }
+        for (const auto& pair : best) {
+            auto& hit = hits[pair.first];
+            hit.first += pair.second;
+            ++hit.second;
+        }
+    }
+    
+    int cursorScore = 0;
+    std::string cursorId;
+    bool hasCursor = parseCursor(cursor, cursorScore, cursorId);
+    
+    std::vector<SearchResult> results;
+    for (const auto& pair : hits) {
+        if (matchAll && pair.second.second < terms.size()) {
+            continue;
+        }
+        SearchResult result{pair.first, pair.second.first +
+                            std::min(getUsageCount(pair.first->getIdentifier()), 20) * 5};
+        if (hasCursor && (result.score > cursorScore ||
+                          (result.score == cursorScore && result.food->getIdentifier() <= cursorId))) {
+            continue; // Already returned on an earlier page
+        }
+        results.push_back(result);
+    }
+    
+    size_t count = std::min(limit, results.size());
+    std::partial_sort(results.begin(), results.begin() + count, results.end(), ranksBefore);
+    page.results.assign(results.begin(), results.begin() + count);
+    if (results.size() > count) {
+        const SearchResult& last = page.results.back();
+        page.nextCursor = std::to_string(last.score) + ":" + last.food->getIdentifier();
+    }
+    return page;
+}
+
+std::vector<const Food*> FoodDatabase::autocomplete(const std::string& prefix, size_t limit) {
+    YADA_TIME_SCOPE(Autocomplete);
+    std::vector<const Food*> completions;
+    if (limit == 0) {
+        return completions;
+    }
+    if (termIndexStale) {
+        rebuildTermIndex();
+    }
+    
+    std::string folded = foldText(prefix);
+    size_t begin = 0;
+    size_t end = 0;
+    if (!prefixIndex.findRange(folded, begin, end)) {
+        begin = end = 0;
+    }
+    auto added = std::lower_bound(addedTerms.begin(), addedTerms.end(), folded,
+                                  [](const std::pair<std::string, const Food*>& a, const std::string& b) {
+                                      return a.first < b;
+                                  });
+    auto addedEnd = added;
+    while (addedEnd != addedTerms.end() && addedEnd->first.compare(0, folded.size(), folded) == 0) {
+        ++addedEnd;
+    }
+    
+    // A food can be listed under several terms in the range ("apple" as
+    // identifier and keyword), so skip the ones already taken
+    std::unordered_set<const Food*> seen;
+    auto take = [&](const Food* food) {
+        if (completions.size() < limit && seen.insert(food).second) {
+            completions.push_back(food);
+        }
+    };
+    // Both ranges are in term order and never share a term, so merging
+    // them gives the order of a single index
+    size_t term = begin;
+    while (completions.size() < limit && (term < end || added != addedEnd)) {
+        if (added == addedEnd || (term < end && fuzzyIndex.getTerm(static_cast<uint32_t>(term)) < added->first)) {
+            for (const Food* food : termPostings[term]) {
+                take(food);
+                if (completions.size() == limit) break;
+            }
+            ++term;
+        } else {
+            take(added->second);
+            ++added;
+        }
+    }
+    return completions;
+}
+
+void FoodDatabase::setUsageStats(const FoodUsageStats* stats) {
+    usageStats = stats;
+}
+
+int FoodDatabase::getUsageCount(const std::string& id) const {
+    return usageStats ? static_cast<int>(usageStats->getUseCount(id)) : 0;
+}
+
+void FoodDatabase::setParallelSearchThreshold(size_t threshold) {
+    parallelSearchThreshold = threshold;
+}
+
+size_t FoodDatabase::getParallelSearchThreshold() const {
+    return parallelSearchThreshold;
+}
+
+unsigned long FoodDatabase::getGeneration() const {
+    return generation;
+}
+
+size_t FoodDatabase::getSearchCacheHits() const {
+    return searchCacheHits;
+}
+
+size_t FoodDatabase::getSearchCacheMisses() const {
+    return searchCacheMisses;
+}
+
+void FoodDatabase::clearSearchCache() {
+    searchCache.clear();
+    searchCacheIndex.clear();
+}
+
+std::vector<const Food*> FoodDatabase::getAllFoods() {
+    return getSortedFoods();
+}
+
+FoodSpan FoodDatabase::viewAllFoods() {
+    return FoodSpan(getSortedFoods());
+}
+
+const std::vector<const Food*>& FoodDatabase::getSortedFoods() {
+    if (sortedGeneration != generation) {
+        sortedFoods.clear();
+        sortedFoods.reserve(liveCount);
+        for (const FoodRecord& record : index) {
+            if (record.live) {
+                sortedFoods.push_back(record.live);
+            }
+        }
+        std::sort(sortedFoods.begin(), sortedFoods.end(), [](const Food* a, const Food* b) {
+            return a->getIdentifier() < b->getIdentifier();
+        });
+        sortedGeneration = generation;
+    }
+    return sortedFoods;
+}
+
+Food* FoodDatabase::createFromLine(const std::string& line, std::vector<PendingComposite>& pending) {
+    std::istringstream iss(line);
+    std::string type, id, keywordsStr, rest;
+    
+    // Parse line using semicolons as separators
+    std::getline(iss, type, ';');
+    std::getline(iss, id, ';');
+    std::getline(iss, keywordsStr, ';');
+    std::getline(iss, rest);
+    
+    // Parse keywords
+    std::vector<std::string> keywords;
+    std::istringstream keywordStream(keywordsStr);
+    std::string keyword;
+    while (std::getline(keywordStream, keyword, ',')) {
+        keywords.push_back(keyword);
+    }
+    
+    if (type == "BASIC") {
+        return arena.create<BasicFood>(id, keywords, parseBasicNutrients(rest));
+    } else if (type == "COMPOSITE") {
+        PendingComposite composite;
+        composite.food = arena.create<CompositeFood>(id, keywords, std::vector<FoodComponent>());
+        composite.live = false;
+        
+        // Parse components; they may refer to foods later in the file
+        std::istringstream componentStream(rest);
+        std::string componentStr;
+        while (std::getline(componentStream, componentStr, ',')) {
+            std::istringstream componentParts(componentStr);
+            std::string componentId, servingsStr;
+            
+            std::getline(componentParts, componentId, ':');
+            std::getline(componentParts, servingsStr);
+            composite.componentRefs.push_back(std::make_pair(componentId, std::stod(servingsStr)));
+        }
+        
+        pending.push_back(std::move(composite));
+        return pending.back().food;
     }
     return nullptr;
 }
 
-std::vector<std::shared_ptr<Food>> FoodDatabase::findFoods(const std::vector<std::string>& keywords, bool matchAll) {
-    std::vector<std::shared_ptr<Food>> results;
-    for (const auto& pair : foods) {
-        if ((matchAll && pair.second->matchesAllKeywords(keywords)) ||
-            (!matchAll && pair.second->matchesAnyKeyword(keywords))) {
-            results.push_back(pair.second);
+bool FoodDatabase::resolveComponents(PendingComposite& composite, std::vector<std::string>* problems) {
+    bool complete = true;
+    auto& components = composite.food->components;
+    components.reserve(composite.componentRefs.size());
+    for (const auto& ref : composite.componentRefs) {
+        std::string id;
+        uint32_t version = 1;
+        bool pinned = splitReference(ref.first, id, version);
+        const FoodRecord* record = index.find(id);
+        const Food* live = record ? record->live : nullptr;
+        const Food* component = composite.live && !pinned ? live : getFoodVersion(id, version);
+        if (!component && composite.live && live) {
+            // The version was lost with foods.txt.versions; a live composite
+            // is always saved against its components' live versions
+            component = live;
+            if (problems) {
+                problems->push_back(composite.food->getIdentifier() + ": component " + ref.first +
+                                    " not found, using the current " + id);
+            }
+        }
+        if (component) {
+            components.push_back(FoodComponent(component, ref.second));
+        } else {
+            complete = false;
+            if (problems) {
+                problems->push_back(composite.food->getIdentifier() + ": component " + ref.first +
+                                    " not found, left out");
+            }
         }
     }
-    return results;
+    return complete;
 }
 
-std::vector<std::shared_ptr<Food>> FoodDatabase::getAllFoods() {
-    std::vector<std::shared_ptr<Food>> allFoods;
-    for (const auto& pair : foods) {
-        allFoods.push_back(pair.second);
+const Food* FoodDatabase::parseFood(const std::string& line) {
+    std::vector<PendingComposite> pending;
+    Food* food = createFromLine(line, pending);
+    if (!food) {
+        return nullptr;
     }
-    return allFoods;
+    // Only a complete food takes a version number
+    for (auto& composite : pending) {
+        if (!resolveComponents(composite)) {
+            return nullptr;
+        }
+    }
+    return assignVersion(food);
 }
 
 bool FoodDatabase::loadDatabase() {
-    foods.clear();
+    YADA_TIME_SCOPE(LoadDatabase);
+    // Foods from an earlier load stay in the arena, so existing handles remain valid
+    index.clear();
+    liveCount = 0;
+    dependents.clear();
+    loadErrors.clear();
+    termIndexStale = true;
+    publish(FoodMap());
+    ++generation;
     std::ifstream file(databaseFile);
     if (!file.is_open()) {
-        std::cout << "Could not open database file. Creating a new one when saving." << std::endl;
         return false;
     }
     
+    // Without a versions file every food is at version 1
+    std::unordered_map<std::string, uint32_t> liveVersions;
+    std::vector<std::pair<uint32_t, std::string>> history;
+    loadVersions(liveVersions, history);
+    
+    std::vector<PendingComposite> pending;
     std::string line;
     while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type, id, keywordsStr, componentsStr;
-        
-        // Parse line using semicolons as separators
-        std::getline(iss, type, ';');
-        std::getline(iss, id, ';');
-        std::getline(iss, keywordsStr, ';');
-        
-        // Parse keywords
-        std::vector<std::string> keywords;
-        std::istringstream keywordStream(keywordsStr);
-        std::string keyword;
-        while (std::getline(keywordStream, keyword, ',')) {
-            keywords.push_back(keyword);
+        size_t composites = pending.size();
+        Food* food = createFromLine(line, pending);
+        if (pending.size() > composites) {
+            pending.back().live = true;
         }
-        
-        if (type == "BASIC") {
-            std::string caloriesStr;
-            std::getline(iss, caloriesStr);
-            double calories = std::stod(caloriesStr);
-            
-            auto food = std::make_shared<BasicFood>(id, keywords, calories);
-            foods[id] = food;
-        } 
-        else if (type == "COMPOSITE") {
-            std::getline(iss, componentsStr);
-            
-            // Parse components
-            std::vector<FoodComponent> components;
-            std::istringstream componentStream(componentsStr);
-            std::string componentStr;
-            
-            while (std::getline(componentStream, componentStr, ',')) {
-                std::istringstream componentParts(componentStr);
-                std::string componentId, servingsStr;
-                
-                std::getline(componentParts, componentId, ':');
-                std::getline(componentParts, servingsStr);
-                double servings = std::stod(servingsStr);
-                
-                // Store component with a placeholder - will resolve after loading all foods
-                components.push_back(FoodComponent(nullptr, servings));
-                components.back().food = std::make_shared<BasicFood>(componentId, std::vector<std::string>(), 0);
+        if (food) {
+            auto live = liveVersions.find(food->getIdentifier());
+            if (live != liveVersions.end()) {
+                food->version = live->second;
             }
-            
-            auto food = std::make_shared<CompositeFood>(id, keywords, components);
-            foods[id] = food;
+            setLive(food);
+            recordVersion(food);
+        }
+    }
+    for (const auto& entry : history) {
+        Food* food = createFromLine(entry.second, pending);
+        if (food) {
+            food->version = entry.first;
+            recordVersion(food);
         }
     }
     
-    // Resolve component references
-    for (auto& pair : foods) {
-        auto compositeFood = std::dynamic_pointer_cast<CompositeFood>(pair.second);
-        if (compositeFood) {
-            auto& components = const_cast<std::vector<FoodComponent>&>(compositeFood->getComponents());
-            for (auto& component : components) {
-                std::string componentId = component.food->getIdentifier();
-                component.food = foods[componentId];
-            }
+    // Resolve component references, now that every version is known
+    for (auto& composite : pending) {
+        resolveComponents(composite, &loadErrors);
+    }
+    for (const FoodRecord& record : index) {
+        if (record.live) {
+            linkComponents(record.live);
         }
     }
+    publishLive();
     
     file.close();
     return true;
 }
-bool FoodDatabase::removeFood(const std::string& id) {
-    auto it = foods.find(id);
-    if (it != foods.end()) {
-        foods.erase(it);
-        return true;
+
+const std::vector<std::string>& FoodDatabase::getLoadErrors() const {
+    return loadErrors;
+}
+
+bool FoodDatabase::removeFood(const std::string& id, RemovePolicy policy, std::vector<const Food*>* removed) {
+    const Food* food = getFood(id);
+    if (!food) {
+        return false;
     }
-    return false;
+    std::vector<const Food*> users = getAllDependents(food);
+    if (!users.empty() && policy == RemovePolicy::Block) {
+        return false;
+    }
+    
+    // Outermost composites first, so nothing live ever points at a removed
+    // food. Removed versions stay in the index for the entries that use them.
+    users.insert(users.begin(), food);
+    bool publishing = batchDepth == 0;
+    FoodMap map = publishing ? *snapshot : FoodMap();
+    for (auto user = users.rbegin(); user != users.rend(); ++user) {
+        unlinkComponents(*user);
+        dependents.erase(*user);
+        updateTermIndex(*user, nullptr);
+        index.find((*user)->getIdentifier())->live = nullptr;
+        --liveCount;
+        if (publishing) {
+            map = map.erase((*user)->getIdentifier());
+        }
+        if (removed) {
+            removed->push_back(*user);
+        }
+    }
+    publish(map);
+    ++generation;
+    return true;
 }
 
 bool FoodDatabase::saveDatabase() {
+    YADA_TIME_SCOPE(SaveDatabase);
     std::ofstream file(databaseFile);
     if (!file.is_open()) {
-        std::cout << "Could not open database file for writing." << std::endl;
         return false;
     }
     
-    for (const auto& pair : foods) {
-        file << pair.second->serialize() << std::endl;
+    TextWriter out(&file);
+    for (const Food* food : getSortedFoods()) {
+        food->serializeTo(out);
+        out << '\n';
     }
+    out.flush();
     
     file.close();
+    return saveVersions();
+}
+
+// The versions file sits next to the database file. Its lines are
+// "L;<identifier>;<version>" for live foods past version 1 and
+// "V;<version>;<food line>" for every earlier or removed version.
+bool FoodDatabase::loadVersions(std::unordered_map<std::string, uint32_t>& liveVersions,
+                                std::vector<std::pair<uint32_t, std::string>>& history) const {
+    std::ifstream file(databaseFile + ".versions");
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 2, "L;") == 0) {
+            size_t separator = line.rfind(';');
+            if (separator > 2) {
+                liveVersions[line.substr(2, separator - 2)] =
+                    static_cast<uint32_t>(std::stoul(line.substr(separator + 1)));
+            }
+        } else if (line.compare(0, 2, "V;") == 0) {
+            size_t separator = line.find(';', 2);
+            if (separator != std::string::npos) {
+                history.push_back(std::make_pair(static_cast<uint32_t>(std::stoul(line.substr(2, separator - 2))),
+                                                 line.substr(separator + 1)));
+            }
+        }
+    }
+    return true;
+}
+
+bool FoodDatabase::saveVersions() const {
+    std::ofstream file(databaseFile + ".versions");
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    TextWriter out(&file);
+    for (const FoodRecord& record : index) {
+        for (const Food* food : record.versions) {
+            size_t version = food->getVersion();
+            if (food == record.live) {
+                if (version > 1) {
+                    out << "L;" << food->getIdentifier() << ';' << version << '\n';
+                }
+            } else {
+                out << "V;" << version << ';';
+                food->serializeTo(out);
+                out << '\n';
+            }
+        }
+    }
+    out.flush();
     return true;
 }
\ No newline at end of file
@@ -2,19 +2,161 @@
 #define FOOD_DATABASE_H
 
 #include "Food.hpp"
-#include <map>
+#include "FoodArena.hpp"
+#include "FoodIndex.hpp"
+#include "FoodMap.hpp"
+#include "FuzzyIndex.hpp"
+#include "PrefixIndex.hpp"
 #include <string>
 #include <memory>
-#include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+class FoodUsageStats;
+
+// Read-only view of foods held by the database, iterated in place.
+// Valid until the database next changes or runs another search.
+class FoodSpan {
+private:
+    const Food* const* first;
+    size_t count;
+    
+public:
+    FoodSpan() : first(nullptr), count(0) {}
+    explicit FoodSpan(const std::vector<const Food*>& foods) : first(foods.data()), count(foods.size()) {}
+    
+    const Food* const* begin() const { return first; }
+    const Food* const* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Food* operator[](size_t i) const { return first[i]; }
+};
+
+// A search hit and its relevance score
+struct SearchResult {
+    const Food* food;
+    int score;
+};
+
+// One page of ranked results; nextCursor is empty when there are no more
+struct SearchPage {
+    std::vector<SearchResult> results;
+    std::string nextCursor;
+};
+
+// What removeFood() does with composites that use the food
+enum class RemovePolicy {
+    Block,   // Refuse while any live composite uses it
+    Cascade  // Remove those composites too, and whatever uses them
+};
 
 class FoodDatabase {
 private:
+    // Cached findFoods() result, valid while generation matches the database's
+    struct CachedSearch {
+        std::string key;
+        unsigned long generation;
+        std::vector<const Food*> results;
+    };
+    static const size_t SEARCH_CACHE_CAPACITY = 64;
+    // Foods per unit of work when matching in parallel; keeps each shard's
+    // food pointers and keyword lists within a core's cache
+    static const size_t SEARCH_SHARD_SIZE = 4096;
+    // Databases at least this large are searched on the TaskPool by default
+    static const size_t PARALLEL_SEARCH_THRESHOLD = 65536;
+    
     static FoodDatabase* instance;
-    std::map<std::string, std::shared_ptr<Food>> foods;
+    // Owns every food ever created
+    FoodArena arena;
+    // Primary lookup: per identifier, the live food and every published
+    // version (including removed ones, which pinned references still use)
+    FoodIndex index;
+    size_t liveCount;
+    // Live foods as a persistent map, replaced after every change; readers
+    // on other threads load it atomically (see getSnapshot())
+    std::shared_ptr<const FoodMap> snapshot;
+    // Open beginBatch() calls; while any is open the snapshot is rebuilt
+    // once by endBatch() instead of after every change
+    size_t batchDepth;
+    // Reverse dependency index: the live composites that have each food as
+    // a direct component. Kept in step with the live foods.
+    std::unordered_map<const Food*, std::vector<const Food*>> dependents;
+    // Per-user usage, owned by the application; used for ranking
+    const FoodUsageStats* usageStats;
     std::string databaseFile;
     
+    // Bumped by every change to the food set; invalidates cached searches
+    unsigned long generation;
+    // Most recently used search first
+    std::list<CachedSearch> searchCache;
+    std::unordered_map<std::string, std::list<CachedSearch>::iterator> searchCacheIndex;
+    size_t searchCacheHits;
+    size_t searchCacheMisses;
+    size_t parallelSearchThreshold;
+    
+    // Live foods in identifier order, sorted again only when generation
+    // changes and something needs the order (listing, searching, saving)
+    std::vector<const Food*> sortedFoods;
+    unsigned long sortedGeneration;
+    
+    // Term indexes over folded keywords, identifiers and identifier words:
+    // typo-tolerant lookup and prefix completion share one term order, and
+    // postings (sorted by identifier) are indexed by term. Single adds,
+    // edits and removals update the postings in place; terms the indexes
+    // don't have yet go to addedTerms (sorted by term, then identifier)
+    // until it outgrows TERM_OVERLAY_LIMIT. Loads and batches mark the
+    // indexes stale, and they are rebuilt on next use.
+    FuzzyIndex fuzzyIndex;
+    PrefixIndex prefixIndex;
+    std::vector<std::vector<const Food*>> termPostings;
+    std::vector<std::pair<std::string, const Food*>> addedTerms;
+    bool termIndexStale;
+    static const size_t TERM_OVERLAY_LIMIT = 1024;
+    
+    // Unresolved components found by the last loadDatabase()
+    std::vector<std::string> loadErrors;
+    
+    // A composite whose components are still identifiers
+    struct PendingComposite {
+        CompositeFood* food;
+        std::vector<std::pair<std::string, double>> componentRefs;
+        // A live foods.txt line: a bare identifier names the live food, as
+        // hand-edited files mean it, instead of version 1
+        bool live;
+    };
+    
+    // Gives a newly created food the next version of its identifier
+    Food* assignVersion(Food* food);
+    void recordVersion(const Food* food);
+    void publish(const FoodMap& map);
+    void publishLive();
+    // Makes next the live food in old's place
+    void replaceFood(const Food* old, const Food* next);
+    void setLive(const Food* food);
+    bool loadVersions(std::unordered_map<std::string, uint32_t>& liveVersions,
+                      std::vector<std::pair<uint32_t, std::string>>& history) const;
+    bool saveVersions() const;
+
+    // Creates the food for a serialized line; composites are added to pending
+    // and get their components once resolveComponents() is called
+    Food* createFromLine(const std::string& line, std::vector<PendingComposite>& pending);
+    // Returns false if a referenced food doesn't exist (it is left out).
+    // Each missing reference is described in problems, if given.
+    bool resolveComponents(PendingComposite& composite, std::vector<std::string>* problems = nullptr);
+    // Both take keywords already folded with foldText()
+    const std::vector<const Food*>& cachedSearch(const std::vector<std::string>& foldedKeywords, bool matchAll);
+    int scoreFood(const Food& food, const std::vector<std::string>& foldedKeywords) const;
+    void rebuildTermIndex();
+    // Keeps the term indexes in step when removed stops being live and/or
+    // added becomes live (either may be nullptr)
+    void updateTermIndex(const Food* removed, const Food* added);
+    const std::vector<const Food*>& getSortedFoods();
+    void linkComponents(const Food* food);
+    void unlinkComponents(const Food* food);
+    
     FoodDatabase();
     
 public:
@@ -22,12 +164,84 @@ public:
     ~FoodDatabase();
     
     void setDatabaseFile(const std::string& file);
-    bool addFood(std::shared_ptr<Food> food);
-    bool removeFood(const std::string& id);
-    std::shared_ptr<Food> getFood(const std::string& id);
-    std::vector<std::shared_ptr<Food>> findFoods(const std::vector<std::string>& keywords, bool matchAll);
-    std::vector<std::shared_ptr<Food>> getAllFoods();
+    // Foods are allocated in the database's arena and stay valid for its
+    // lifetime; addFood() only accepts foods created by these methods.
+    const Food* createBasicFood(const std::string& id, const std::vector<std::string>& keys,
+                                const NutrientVector& nutrients);
+    const Food* createCompositeFood(const std::string& id, const std::vector<std::string>& keys,
+                                    const std::vector<FoodComponent>& components);
+    bool addFood(const Food* food);
+    // Bulk changes: between these, adds, updates and removals skip publishing
+    // a snapshot each, and endBatch() publishes once. The search and term
+    // indexes are already rebuilt lazily on first use after a change.
+    // Nestable; getSnapshot() lags behind until the outermost endBatch().
+    void beginBatch();
+    void endBatch();
+    // Removes the food with this identifier. With Block it fails while live
+    // composites use it; with Cascade they are removed first. removed, if
+    // given, receives every food taken out, outermost composite first.
+    bool removeFood(const std::string& id, RemovePolicy policy = RemovePolicy::Block,
+                    std::vector<const Food*>* removed = nullptr);
+    // Publishes food (a new version, from createBasicFood() or
+    // createCompositeFood()) in place of the live food with its identifier.
+    // Composites using the old version, directly or not, get new versions
+    // built on the new one; updated, if given, receives those in use order.
+    // Earlier versions stay valid, so log entries keep what they recorded.
+    bool updateFood(const Food* food, std::vector<const Food*>* updated = nullptr);
+    // Makes earlier versions live again in place of the live foods with
+    // their identifiers, components before the composites using them (e.g.
+    // what updateFood() replaced). Fails, changing nothing, if one isn't live
+    // or a live composite not in the list uses a food being replaced.
+    bool restoreFoods(const std::vector<const Food*>& foods);
+    // Any published version, live or not (nullptr if unknown)
+    const Food* getFoodVersion(const std::string& id, uint32_t version) const;
+    // Resolves a Food::getReference() string; a bare identifier is version 1
+    const Food* resolveReference(const std::string& reference) const;
+    // Immutable view of the live foods as of the last change; cheap to take
+    // and safe to read from any thread while the database keeps changing
+    FoodMap getSnapshot() const;
+    // Live composites with food as a direct component, in no particular order
+    const std::vector<const Food*>& getDependents(const Food* food) const;
+    // Every live composite that uses food, directly or through other
+    // composites; each one comes after the composites it uses
+    std::vector<const Food*> getAllDependents(const Food* food) const;
+    const Food* getFood(const std::string& id);
+    std::vector<const Food*> findFoods(const std::vector<std::string>& keywords, bool matchAll);
+    std::vector<const Food*> getAllFoods();
+    // Same results as findFoods() and getAllFoods(), viewed in place
+    // instead of copied
+    FoodSpan viewFoods(const std::vector<std::string>& keywords, bool matchAll);
+    FoodSpan viewAllFoods();
+    // Best matches first (score, then identifier), at most limit per page.
+    // Pass the previous page's nextCursor to continue after it.
+    SearchPage rankedSearch(const std::vector<std::string>& keywords, bool matchAll,
+                            size_t limit, const std::string& cursor = "");
+    // Like rankedSearch(), but a keyword also matches terms within a small
+    // edit distance (none up to 2 characters, 1 up to 5, otherwise 2),
+    // so "chiken" finds chicken. Closer spellings score higher.
+    SearchPage fuzzySearch(const std::vector<std::string>& keywords, bool matchAll,
+                           size_t limit, const std::string& cursor = "");
+    // Foods with a keyword, identifier or identifier word starting with
+    // prefix, in term order, at most limit of them
+    std::vector<const Food*> autocomplete(const std::string& prefix, size_t limit);
+    // Frequently eaten foods rank higher in rankedSearch()
+    void setUsageStats(const FoodUsageStats* stats);
+    int getUsageCount(const std::string& id) const;
+    
+    unsigned long getGeneration() const;
+    size_t getSearchCacheHits() const;
+    size_t getSearchCacheMisses() const;
+    void clearSearchCache();
+    // Searches over at least this many foods match in parallel shards
+    // (results are identical either way); SIZE_MAX keeps them sequential
+    void setParallelSearchThreshold(size_t threshold);
+    size_t getParallelSearchThreshold() const;
+    // Parses a single serialized food line into a new version; composite
+    // components are resolved as pinned references (nullptr if any is missing)
+    const Food* parseFood(const std::string& line);
     bool loadDatabase();
+    // Composite components loadDatabase() could not find, one message each
+    const std::vector<std::string>& getLoadErrors() const;
     bool saveDatabase();
 };
 
@@ -0,0 +1,394 @@
+#include "FoodImporter.hpp"
+#include "Metrics.hpp"
+#include "TaskPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+const size_t FoodImporter::MAX_ERRORS;
+const size_t FoodImporter::ROWS_PER_TASK;
+const size_t FoodImporter::READ_AHEAD;
+const size_t FoodImporter::DEFAULT_CHUNK_ROWS;
+
+struct FoodImporter::Column {
+    enum Kind { Identifier, Keywords, Calories, NutrientValue } kind;
+    Nutrient nutrient;
+    size_t field;
+};
+
+struct FoodImporter::ParsedRow {
+    bool blank;
+    std::string error;  // Rejected unless empty
+    std::string identifier;
+    std::vector<std::string> keywords;
+    double calories;
+    std::vector<std::pair<Nutrient, double>> nutrients;
+};
+
+// Lines read, then parsed in place by the reader thread
+struct FoodImporter::Chunk {
+    size_t firstLine;
+    size_t bytes;
+    std::vector<std::string> lines;
+    std::vector<ParsedRow> rows;
+};
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+void splitFields(const std::string& line, char delimiter, std::vector<std::string>& fields) {
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c != '"') {
+                field += c;
+            } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                field += '"'; // "" inside quotes
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == delimiter) {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+}
+
+// Trims, turns the separators of the file formats (';' ',' ':') and other
+// whitespace into spaces, and collapses runs of spaces
+std::string normalizeName(const std::string& text) {
+    std::string result;
+    bool space = false;
+    for (char c : text) {
+        if (c == ';' || c == ',' || c == ':' || std::isspace(static_cast<unsigned char>(c))) {
+            space = !result.empty();
+        } else {
+            if (space) {
+                result += ' ';
+                space = false;
+            }
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Header names compare lowercase, with spaces and dashes as underscores and
+// any "(unit)" suffix dropped
+std::string normalizeHeader(const std::string& text) {
+    std::string name = text.substr(0, text.find('('));
+    name.erase(0, name.find_first_not_of(" \t\""));
+    name.erase(name.find_last_not_of(" \t\"") + 1);
+    for (auto& c : name) {
+        if (c == ' ' || c == '-') {
+            c = '_';
+        } else if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return name;
+}
+
+bool isOneOf(const std::string& name, std::initializer_list<const char*> names) {
+    for (const char* candidate : names) {
+        if (name == candidate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseNumber(const std::string& text, double& value) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return false;
+    }
+    const char* start = text.c_str() + begin;
+    char* end = nullptr;
+    value = std::strtod(start, &end);
+    if (end == start || !std::isfinite(value)) {
+        return false;
+    }
+    return std::string(end).find_first_not_of(" \t") == std::string::npos;
+}
+
+bool isSameFood(const Food* food, const std::vector<std::string>& keywords, const NutrientVector& nutrients) {
+    if (food->getKind() != FoodKind::Basic || food->getKeywords() != keywords) {
+        return false;
+    }
+    return food->getNutrientsPerServing() == nutrients;
+}
+
+} // namespace
+
+FoodImporter::FoodImporter(FoodDatabase* database)
+    : db(database), duplicatePolicy(DuplicatePolicy::Skip), chunkRows(DEFAULT_CHUNK_ROWS) {}
+
+void FoodImporter::setDuplicatePolicy(DuplicatePolicy policy) {
+    duplicatePolicy = policy;
+}
+
+void FoodImporter::setChunkRows(size_t rows) {
+    chunkRows = std::max<size_t>(1, rows);
+}
+
+void FoodImporter::setProgressCallback(const std::function<void(const ImportProgress&)>& callback) {
+    progressCallback = callback;
+}
+
+const std::vector<std::string>& FoodImporter::getErrors() const {
+    return errors;
+}
+
+bool FoodImporter::parseHeader(const std::string& line, char delimiter, std::vector<Column>& columns) {
+    std::vector<std::string> fields;
+    splitFields(line, delimiter, fields);
+    bool hasIdentifier = false, hasCalories = false;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        std::string name = normalizeHeader(fields[i]);
+        Nutrient nutrient = Nutrient::Calories;
+        if (!hasIdentifier && isOneOf(name, {"identifier", "id", "name", "food", "food_name", "description"})) {
+            columns.push_back(Column{Column::Identifier, nutrient, i});
+            hasIdentifier = true;
+        } else if (isOneOf(name, {"keywords", "keyword", "tags", "category", "food_group", "group"})) {
+            columns.push_back(Column{Column::Keywords, nutrient, i});
+        } else if (!hasCalories && isOneOf(name, {"calories", "energy", "kcal", "energy_kcal"})) {
+            columns.push_back(Column{Column::Calories, nutrient, i});
+            hasCalories = true;
+        } else if (isOneOf(name, {"carbohydrate", "carbs"})) {
+            columns.push_back(Column{Column::NutrientValue, Nutrient::Carbohydrates, i});
+        } else if (isOneOf(name, {"total_fat"})) {
+            columns.push_back(Column{Column::NutrientValue, Nutrient::Fat, i});
+        } else if (isOneOf(name, {"sugars"})) {
+            columns.push_back(Column{Column::NutrientValue, Nutrient::Sugar, i});
+        } else if (parseNutrientName(name, nutrient) && nutrient != Nutrient::Calories) {
+            columns.push_back(Column{Column::NutrientValue, nutrient, i});
+        }
+    }
+    return hasIdentifier && hasCalories;
+}
+
+void FoodImporter::parseRow(const std::string& line, char delimiter, const std::vector<Column>& columns,
+                            ParsedRow& row) {
+    row.blank = line.find_first_not_of(" \t\r") == std::string::npos;
+    if (row.blank) {
+        return;
+    }
+    std::vector<std::string> fields;
+    splitFields(line, delimiter, fields);
+    for (const Column& column : columns) {
+        if (column.field >= fields.size()) {
+            row.error = "expected at least " + std::to_string(column.field + 1) + " fields, found " +
+                        std::to_string(fields.size());
+            return;
+        }
+    }
+
+    row.calories = 0.0;
+    for (const Column& column : columns) {
+        const std::string& field = fields[column.field];
+        switch (column.kind) {
+            case Column::Identifier:
+                row.identifier = normalizeName(field);
+                if (row.identifier.empty()) {
+                    row.error = "missing identifier";
+                    return;
+                }
+                break;
+            case Column::Keywords: {
+                size_t begin = 0;
+                while (begin <= field.size()) {
+                    size_t end = field.find_first_of(",;|", begin);
+                    if (end == std::string::npos) end = field.size();
+                    std::string keyword = normalizeName(field.substr(begin, end - begin));
+                    if (!keyword.empty() &&
+                        std::find(row.keywords.begin(), row.keywords.end(), keyword) == row.keywords.end()) {
+                        row.keywords.push_back(keyword);
+                    }
+                    begin = end + 1;
+                }
+                break;
+            }
+            case Column::Calories:
+                if (!parseNumber(field, row.calories) || row.calories < 0.0) {
+                    row.error = "bad calories '" + field + "'";
+                    return;
+                }
+                break;
+            case Column::NutrientValue: {
+                if (field.find_first_not_of(" \t") == std::string::npos) {
+                    break; // Not given
+                }
+                double value;
+                if (!parseNumber(field, value) || value < 0.0) {
+                    row.error = std::string("bad ") + getNutrientName(column.nutrient) + " '" + field + "'";
+                    return;
+                }
+                row.nutrients.push_back(std::make_pair(column.nutrient, value));
+                break;
+            }
+        }
+    }
+}
+
+void FoodImporter::insertRow(const ParsedRow& row, size_t lineNumber, ImportProgress& progress) {
+    if (row.blank) {
+        return;
+    }
+    ++progress.rowsRead;
+    if (!row.error.empty()) {
+        ++progress.rejected;
+        if (errors.size() < MAX_ERRORS) {
+            errors.push_back("line " + std::to_string(lineNumber) + ": " + row.error);
+        }
+        return;
+    }
+
+    const Food* existing = db->getFood(row.identifier);
+    if (existing && duplicatePolicy == DuplicatePolicy::Skip) {
+        ++progress.duplicates;
+        return;
+    }
+    NutrientVector nutrients;
+    nutrients.set(Nutrient::Calories, row.calories);
+    for (const auto& value : row.nutrients) {
+        nutrients.set(value.first, value.second);
+    }
+    if (existing && isSameFood(existing, row.keywords, nutrients)) {
+        // Compared before creating, so re-importing a file uses no versions
+        ++progress.duplicates;
+        return;
+    }
+    const Food* food = db->createBasicFood(row.identifier, row.keywords, nutrients);
+    if (!existing) {
+        db->addFood(food);
+        ++progress.imported;
+    } else {
+        db->updateFood(food);
+        ++progress.replaced;
+    }
+}
+
+bool FoodImporter::importFile(const std::string& path, ImportProgress& result) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        errors.assign(1, "cannot open " + path);
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    return importStream(file, size > 0 ? static_cast<size_t>(size) : 0, result);
+}
+
+bool FoodImporter::importStream(std::istream& in, size_t totalBytes, ImportProgress& result) {
+    YADA_TIME_SCOPE(ImportFoods);
+    Clock::time_point start = Clock::now();
+    result = ImportProgress{0, totalBytes, 0, 0, 0, 0, 0, 0.0};
+    errors.clear();
+
+    std::string header;
+    size_t lineNumber = 0;
+    do {
+        if (!std::getline(in, header)) {
+            errors.push_back("no header line");
+            return false;
+        }
+        ++lineNumber;
+        result.bytesRead += header.size() + 1;
+    } while (header.find_first_not_of(" \t\r") == std::string::npos);
+    if (header.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        header.erase(0, 3); // UTF-8 byte order mark
+    }
+    char delimiter = header.find('\t') != std::string::npos ? '\t' : ',';
+    std::vector<Column> columns;
+    if (!parseHeader(header, delimiter, columns)) {
+        errors.push_back("line " + std::to_string(lineNumber) + ": header needs a name and a calories column");
+        return false;
+    }
+
+    // Reader stage: reads a chunk, parses it on the pool, then hands it over,
+    // staying at most READ_AHEAD chunks ahead of the writer
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::unique_ptr<Chunk>> ready;
+    bool finished = false;
+    std::thread reader([&]() {
+        size_t nextLine = lineNumber + 1;
+        bool last = false;
+        while (!last) {
+            std::unique_ptr<Chunk> chunk(new Chunk());
+            chunk->firstLine = nextLine;
+            chunk->bytes = 0;
+            std::string line;
+            while (chunk->lines.size() < chunkRows && std::getline(in, line)) {
+                chunk->bytes += line.size() + 1;
+                chunk->lines.push_back(line);
+            }
+            nextLine += chunk->lines.size();
+            last = chunk->lines.size() < chunkRows;
+
+            Chunk& current = *chunk;
+            current.rows.resize(current.lines.size());
+            size_t tasks = (current.lines.size() + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+            TaskPool::getInstance()->parallelFor(tasks, [&current, &columns, delimiter](size_t task) {
+                size_t end = std::min(current.lines.size(), (task + 1) * ROWS_PER_TASK);
+                for (size_t i = task * ROWS_PER_TASK; i < end; ++i) {
+                    parseRow(current.lines[i], delimiter, columns, current.rows[i]);
+                }
+            });
+
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&ready]() { return ready.size() < READ_AHEAD; });
+            ready.push_back(std::move(chunk));
+            finished = last;
+            changed.notify_all();
+        }
+    });
+
+    // Writer stage: this thread alone inserts, in file order
+    db->beginBatch();
+    bool done = false;
+    while (!done) {
+        std::unique_ptr<Chunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&ready]() { return !ready.empty(); });
+            chunk = std::move(ready.front());
+            ready.pop_front();
+            done = finished && ready.empty();
+            changed.notify_all();
+        }
+        for (size_t i = 0; i < chunk->rows.size(); ++i) {
+            insertRow(chunk->rows[i], chunk->firstLine + i, result);
+        }
+        result.bytesRead += chunk->bytes;
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (progressCallback) {
+            progressCallback(result);
+        }
+    }
+    reader.join();
+    db->endBatch();
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef FOOD_IMPORTER_HPP
+#define FOOD_IMPORTER_HPP
+
+#include "FoodDatabase.hpp"
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+// What to do with a row whose identifier is already in the database
+enum class DuplicatePolicy {
+    Skip,    // Keep the existing food
+    Replace  // Publish the row as a new version (see FoodDatabase::updateFood)
+};
+
+// Running totals of an import, passed to the progress callback after each
+// chunk and returned at the end
+struct ImportProgress {
+    size_t bytesRead;
+    size_t bytesTotal;  // 0 if unknown
+    size_t rowsRead;
+    size_t imported;
+    size_t replaced;
+    size_t duplicates;  // Skipped, or identical to the existing food
+    size_t rejected;
+    double seconds;
+};
+
+// Bulk loader for CSV/TSV nutrition tables.
+// The first line is a header naming the columns: an identifier ("name",
+// "description", ...) and calories ("energy", "kcal", ...) are required;
+// "keywords"/"category" columns and any nutrient name (see
+// parseNutrientName) are optional, the rest are ignored. Tabs in the header
+// select TSV, otherwise fields are comma separated with "quoted" fields.
+//
+// A reader thread reads chunks of rows and parses, validates and
+// normalizes each chunk on the TaskPool while the calling thread inserts
+// the previous one, so parsing overlaps inserting. Only the calling thread
+// touches the database, inside one FoodDatabase batch.
+class FoodImporter {
+private:
+    struct Column;
+    struct ParsedRow;
+    struct Chunk;
+
+    FoodDatabase* db;
+    DuplicatePolicy duplicatePolicy;
+    size_t chunkRows;
+    std::function<void(const ImportProgress&)> progressCallback;
+    // "line N: reason" for the first MAX_ERRORS rejected rows
+    std::vector<std::string> errors;
+    static const size_t MAX_ERRORS = 20;
+    // Rows per parse task, and chunks the reader may get ahead of the writer
+    static const size_t ROWS_PER_TASK = 1024;
+    static const size_t READ_AHEAD = 2;
+
+    static bool parseHeader(const std::string& line, char delimiter, std::vector<Column>& columns);
+    static void parseRow(const std::string& line, char delimiter, const std::vector<Column>& columns,
+                         ParsedRow& row);
+    void insertRow(const ParsedRow& row, size_t lineNumber, ImportProgress& progress);
+
+public:
+    static const size_t DEFAULT_CHUNK_ROWS = 16384;
+
+    explicit FoodImporter(FoodDatabase* database);
+
+    void setDuplicatePolicy(DuplicatePolicy policy);
+    void setChunkRows(size_t rows);
+    void setProgressCallback(const std::function<void(const ImportProgress&)>& callback);
+
+    // False (nothing imported) if the file can't be opened or its header
+    // lacks the required columns
+    bool importFile(const std::string& path, ImportProgress& result);
+    bool importStream(std::istream& in, size_t totalBytes, ImportProgress& result);
+    const std::vector<std::string>& getErrors() const;
+};
+
+#endif // FOOD_IMPORTER_HPP
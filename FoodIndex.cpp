@@ -0,0 +1,79 @@
+#include "FoodIndex.hpp"
+#include <functional>
+
+namespace {
+
+const size_t INITIAL_SLOTS = 64;
+
+size_t hashId(const std::string& id) {
+    return std::hash<std::string>()(id);
+}
+
+} // namespace
+
+const uint32_t FoodIndex::EMPTY;
+
+FoodIndex::FoodIndex() : slots(INITIAL_SLOTS, Slot{0, nullptr, EMPTY}) {}
+
+// The slot holding id, or the empty slot where it would go
+size_t FoodIndex::findSlot(size_t hash, const std::string& id) const {
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].record != EMPTY) {
+        if (slots[i].hash == hash && *slots[i].id == id) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void FoodIndex::grow() {
+    std::vector<Slot> old(slots.size() * 2, Slot{0, nullptr, EMPTY});
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.record == EMPTY) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].record != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
+const FoodRecord* FoodIndex::find(const std::string& id) const {
+    const Slot& slot = slots[findSlot(hashId(id), id)];
+    return slot.record != EMPTY ? &records[slot.record] : nullptr;
+}
+
+FoodRecord* FoodIndex::find(const std::string& id) {
+    return const_cast<FoodRecord*>(static_cast<const FoodIndex*>(this)->find(id));
+}
+
+FoodRecord& FoodIndex::insert(const std::string& id) {
+    size_t hash = hashId(id);
+    size_t i = findSlot(hash, id);
+    if (slots[i].record != EMPTY) {
+        return records[slots[i].record];
+    }
+    // At most half full keeps probe sequences short
+    if ((records.size() + 1) * 2 > slots.size()) {
+        grow();
+        i = findSlot(hash, id);
+    }
+    slots[i] = Slot{hash, &id, static_cast<uint32_t>(records.size())};
+    records.push_back(FoodRecord{nullptr, std::vector<const Food*>(), 0});
+    return records.back();
+}
+
+size_t FoodIndex::size() const {
+    return records.size();
+}
+
+void FoodIndex::clear() {
+    slots.assign(INITIAL_SLOTS, Slot{0, nullptr, EMPTY});
+    records.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef FOOD_INDEX_HPP
+#define FOOD_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+class Food;
+
+// Everything FoodDatabase knows about one identifier
+struct FoodRecord {
+    // nullptr while no version is live (removed)
+    const Food* live;
+    // Every published version, oldest first
+    std::vector<const Food*> versions;
+    // Highest version handed out, so none is ever reused
+    uint32_t lastVersion;
+};
+
+// Primary identifier index of FoodDatabase: an open addressing hash table
+// with linear probing. Each slot keeps the identifier's hash next to a
+// pointer to its interned string, so probes compare hashes first, only
+// touch strings on a likely match, and growing never rehashes a string.
+// Records are never removed (versions outlive removal), so there are no
+// tombstones; records stay at the same address until clear().
+class FoodIndex {
+private:
+    static const uint32_t EMPTY = static_cast<uint32_t>(-1);
+    struct Slot {
+        size_t hash;
+        const std::string* id;
+        uint32_t record;
+    };
+
+    std::vector<Slot> slots;
+    std::deque<FoodRecord> records;
+
+    size_t findSlot(size_t hash, const std::string& id) const;
+    void grow();
+
+public:
+    FoodIndex();
+
+    const FoodRecord* find(const std::string& id) const;
+    FoodRecord* find(const std::string& id);
+    // The record for id, created empty if needed. id must outlive the index
+    // (identifiers interned in SymbolTable do).
+    FoodRecord& insert(const std::string& id);
+    size_t size() const;
+    void clear();
+
+    // Records in insertion order
+    std::deque<FoodRecord>::const_iterator begin() const { return records.begin(); }
+    std::deque<FoodRecord>::const_iterator end() const { return records.end(); }
+};
+
+#endif // FOOD_INDEX_HPP
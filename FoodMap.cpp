@@ -0,0 +1,245 @@
+#include "FoodMap.hpp"
+#include "Food.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+
+const unsigned HASH_BITS = std::numeric_limits<size_t>::digits;
+
+size_t hashId(const std::string& id) {
+    return std::hash<std::string>()(id);
+}
+
+unsigned digitAt(size_t hash, unsigned shift) {
+    return static_cast<unsigned>(hash >> shift) & 31u;
+}
+
+unsigned popcount(uint32_t bits) {
+    return static_cast<unsigned>(__builtin_popcount(bits));
+}
+
+} // namespace
+
+FoodMap::FoodMap() : count(0) {}
+
+FoodMap::FoodMap(std::shared_ptr<const Node> r, size_t c) : root(std::move(r)), count(c) {}
+
+FoodMap::Slot FoodMap::leaf(size_t hash, const Food* food) {
+    return Slot{hash, &food->getIdentifier(), food, nullptr};
+}
+
+std::shared_ptr<const FoodMap::Node> FoodMap::set(const std::shared_ptr<const Node>& node, unsigned shift,
+                                                  size_t hash, const Food* food, bool& added) {
+    if (shift >= HASH_BITS) {
+        // Out of hash digits: a flat bucket of full collisions
+        std::shared_ptr<Node> copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        for (auto& slot : copy->slots) {
+            if (*slot.id == food->getIdentifier()) {
+                slot.food = food;
+                return copy;
+            }
+        }
+        copy->slots.push_back(leaf(hash, food));
+        added = true;
+        return copy;
+    }
+
+    uint32_t bit = 1u << digitAt(hash, shift);
+    std::shared_ptr<Node> copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>(Node{0, {}});
+    size_t index = popcount(copy->bitmap & (bit - 1));
+    if (!(copy->bitmap & bit)) {
+        copy->bitmap |= bit;
+        copy->slots.insert(copy->slots.begin() + index, leaf(hash, food));
+        added = true;
+        return copy;
+    }
+
+    Slot& slot = copy->slots[index];
+    if (slot.child) {
+        slot.child = set(slot.child, shift + BITS_PER_LEVEL, hash, food, added);
+    } else if (*slot.id == food->getIdentifier()) {
+        slot.food = food;
+    } else {
+        // Two leaves share this digit: push both down a level
+        bool ignored = false;
+        std::shared_ptr<const Node> child = set(nullptr, shift + BITS_PER_LEVEL, slot.hash, slot.food, ignored);
+        slot.child = set(child, shift + BITS_PER_LEVEL, hash, food, added);
+        slot.food = nullptr;
+        slot.id = nullptr;
+        slot.hash = 0;
+    }
+    return copy;
+}
+
+std::shared_ptr<const FoodMap::Node> FoodMap::erase(const std::shared_ptr<const Node>& node, unsigned shift,
+                                                    size_t hash, const std::string& id, bool& removed) {
+    if (!node) {
+        return node;
+    }
+    if (shift >= HASH_BITS) {
+        for (size_t i = 0; i < node->slots.size(); ++i) {
+            if (*node->slots[i].id == id) {
+                removed = true;
+                if (node->slots.size() == 1) {
+                    return nullptr;
+                }
+                std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+                copy->slots.erase(copy->slots.begin() + i);
+                return copy;
+            }
+        }
+        return node;
+    }
+
+    uint32_t bit = 1u << digitAt(hash, shift);
+    if (!(node->bitmap & bit)) {
+        return node;
+    }
+    size_t index = popcount(node->bitmap & (bit - 1));
+    const Slot& slot = node->slots[index];
+    std::shared_ptr<const Node> child;
+    if (slot.child) {
+        child = erase(slot.child, shift + BITS_PER_LEVEL, hash, id, removed);
+        if (!removed) {
+            return node;
+        }
+    } else if (*slot.id == id) {
+        removed = true;
+    } else {
+        return node;
+    }
+
+    std::shared_ptr<Node> copy = std::make_shared<Node>(*node);
+    if (!child) {
+        copy->bitmap &= ~bit;
+        copy->slots.erase(copy->slots.begin() + index);
+        if (copy->slots.empty()) {
+            return nullptr;
+        }
+    } else if (child->slots.size() == 1 && !child->slots[0].child) {
+        // A lone leaf moves back up, keeping paths short
+        copy->slots[index] = child->slots[0];
+    } else {
+        copy->slots[index].child = child;
+    }
+    return copy;
+}
+
+std::shared_ptr<const FoodMap::Node> FoodMap::build(std::vector<std::pair<size_t, const Food*>>& entries,
+                                                    size_t begin, size_t end, unsigned shift) {
+    std::shared_ptr<Node> node = std::make_shared<Node>(Node{0, {}});
+    if (shift >= HASH_BITS) {
+        for (size_t i = begin; i < end; ++i) {
+            node->slots.push_back(leaf(entries[i].first, entries[i].second));
+        }
+        return node;
+    }
+
+    // Counting sort of the range by this level's digit, then one slot per
+    // digit present
+    size_t counts[33] = {};
+    for (size_t i = begin; i < end; ++i) {
+        ++counts[digitAt(entries[i].first, shift) + 1];
+    }
+    for (unsigned d = 0; d < 32; ++d) {
+        counts[d + 1] += counts[d];
+    }
+    std::vector<std::pair<size_t, const Food*>> sorted(end - begin);
+    size_t next[32];
+    std::copy(counts, counts + 32, next);
+    for (size_t i = begin; i < end; ++i) {
+        sorted[next[digitAt(entries[i].first, shift)]++] = entries[i];
+    }
+    std::copy(sorted.begin(), sorted.end(), entries.begin() + begin);
+
+    for (unsigned d = 0; d < 32; ++d) {
+        size_t first = begin + counts[d];
+        size_t last = begin + counts[d + 1];
+        if (first == last) {
+            continue;
+        }
+        node->bitmap |= 1u << d;
+        if (last - first == 1) {
+            node->slots.push_back(leaf(entries[first].first, entries[first].second));
+        } else {
+            node->slots.push_back(Slot{0, nullptr, nullptr, build(entries, first, last, shift + BITS_PER_LEVEL)});
+        }
+    }
+    return node;
+}
+
+FoodMap FoodMap::fromFoods(const std::vector<const Food*>& foods) {
+    if (foods.empty()) {
+        return FoodMap();
+    }
+    std::vector<std::pair<size_t, const Food*>> entries;
+    entries.reserve(foods.size());
+    for (const Food* food : foods) {
+        entries.push_back(std::make_pair(hashId(food->getIdentifier()), food));
+    }
+    return FoodMap(build(entries, 0, entries.size(), 0), entries.size());
+}
+
+const Food* FoodMap::find(const std::string& id) const {
+    size_t hash = hashId(id);
+    const Node* node = root.get();
+    unsigned shift = 0;
+    while (node) {
+        if (shift >= HASH_BITS) {
+            for (const auto& slot : node->slots) {
+                if (*slot.id == id) {
+                    return slot.food;
+                }
+            }
+            return nullptr;
+        }
+        uint32_t bit = 1u << digitAt(hash, shift);
+        if (!(node->bitmap & bit)) {
+            return nullptr;
+        }
+        const Slot& slot = node->slots[popcount(node->bitmap & (bit - 1))];
+        if (!slot.child) {
+            return *slot.id == id ? slot.food : nullptr;
+        }
+        node = slot.child.get();
+        shift += BITS_PER_LEVEL;
+    }
+    return nullptr;
+}
+
+size_t FoodMap::size() const {
+    return count;
+}
+
+void FoodMap::collect(const Node& node, std::vector<const Food*>& foods) {
+    for (const auto& slot : node.slots) {
+        if (slot.child) {
+            collect(*slot.child, foods);
+        } else {
+            foods.push_back(slot.food);
+        }
+    }
+}
+
+std::vector<const Food*> FoodMap::getFoods() const {
+    std::vector<const Food*> foods;
+    foods.reserve(count);
+    if (root) {
+        collect(*root, foods);
+    }
+    return foods;
+}
+
+FoodMap FoodMap::set(const Food* food) const {
+    bool added = false;
+    std::shared_ptr<const Node> newRoot = set(root, 0, hashId(food->getIdentifier()), food, added);
+    return FoodMap(newRoot, count + (added ? 1 : 0));
+}
+
+FoodMap FoodMap::erase(const std::string& id) const {
+    bool removed = false;
+    std::shared_ptr<const Node> newRoot = erase(root, 0, hashId(id), id, removed);
+    return removed ? FoodMap(newRoot, count - 1) : *this;
+}
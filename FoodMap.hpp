@@ -0,0 +1,67 @@
+#ifndef FOOD_MAP_HPP
+#define FOOD_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Food;
+
+// Persistent (immutable) map from identifier to food: a hash array mapped
+// trie. Nodes are never modified once built; set() and erase() copy only
+// the path to the changed entry and share the rest, so every FoodMap is a
+// cheap, independent snapshot that can be read from any thread.
+class FoodMap {
+private:
+    struct Node;
+    // A leaf (food set) or a link to the next level (child set). Leaves
+    // keep the identifier string (owned by SymbolTable, never moves) so
+    // readers don't touch the symbol table, which isn't thread-safe.
+    struct Slot {
+        size_t hash;
+        const std::string* id;
+        const Food* food;
+        std::shared_ptr<const Node> child;
+    };
+    // 32-way node; bitmap marks which hash digits are present and slots
+    // holds them in digit order. Below the last digit, nodes hold colliding
+    // leaves in any order.
+    struct Node {
+        uint32_t bitmap;
+        std::vector<Slot> slots;
+    };
+
+    std::shared_ptr<const Node> root;
+    size_t count;
+
+    static const unsigned BITS_PER_LEVEL = 5;
+
+    FoodMap(std::shared_ptr<const Node> r, size_t c);
+    static Slot leaf(size_t hash, const Food* food);
+    static std::shared_ptr<const Node> set(const std::shared_ptr<const Node>& node, unsigned shift,
+                                           size_t hash, const Food* food, bool& added);
+    static std::shared_ptr<const Node> erase(const std::shared_ptr<const Node>& node, unsigned shift,
+                                             size_t hash, const std::string& id, bool& removed);
+    static std::shared_ptr<const Node> build(std::vector<std::pair<size_t, const Food*>>& entries,
+                                             size_t begin, size_t end, unsigned shift);
+    static void collect(const Node& node, std::vector<const Food*>& foods);
+
+public:
+    FoodMap();
+    // Bulk construction, much cheaper than a set() per food
+    static FoodMap fromFoods(const std::vector<const Food*>& foods);
+
+    const Food* find(const std::string& id) const;
+    size_t size() const;
+    // Foods in no particular order
+    std::vector<const Food*> getFoods() const;
+
+    // New maps with the food added (replacing any with its identifier) or
+    // removed; this map is unchanged
+    FoodMap set(const Food* food) const;
+    FoodMap erase(const std::string& id) const;
+};
+
+#endif // FOOD_MAP_HPP
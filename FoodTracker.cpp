@@ -1,6 +1,8 @@
 #include "FoodTracker.hpp"
+#include "Metrics.hpp"
 
-FoodTracker::FoodTracker(DailyLog& l, DietProfile& p) : log(l), profile(p) {
+FoodTracker::FoodTracker(DailyLog& l, DietProfile& p)
+    : log(l), profile(p), logRevision(l.getRevision()), profileRevision(p.getRevision()) {
     log.addObserver(this);
     profile.addObserver(this);
 }
@@ -11,19 +13,93 @@ FoodTracker::~FoodTracker() {
 }
 
 void FoodTracker::update(Subject* subject) {
+    if (subject == &log) {
+        applyLogChange();
+    } else if (subject == &profile) {
+        applyProfileChange();
+    }
 
     if(subject!=&profile){
         displayDailySummary();
     }
 }
 
+void FoodTracker::applyLogChange() {
+    if (log.getRevision() == logRevision) {
+        return; // only the current date changed
+    }
+    const LogChange& change = log.getLastChange();
+    bool incremental = log.getRevision() == logRevision + 1 &&
+        (change.kind == LogChangeKind::EntryAdded || change.kind == LogChangeKind::EntryRemoved);
+    logRevision = log.getRevision();
+    
+    if (!incremental) {
+        for (auto& pair : cache) pair.second.hasConsumed = false;
+        return;
+    }
+    auto it = cache.find(change.date);
+    if (it != cache.end() && it->second.hasConsumed) {
+        it->second.consumed += change.calorieDelta;
+    }
+}
+
+void FoodTracker::applyProfileChange() {
+    const ProfileChange& change = profile.getLastChange();
+    bool dated = profile.getRevision() == profileRevision + 1 &&
+        (change.kind == ProfileChangeKind::Weight || change.kind == ProfileChangeKind::ActivityLevel);
+    profileRevision = profile.getRevision();
+    
+    if (!dated) {
+        for (auto& pair : cache) pair.second.hasTarget = false;
+        return;
+    }
+    // Only dates from the change up to the next entry of the same kind use the new value
+    std::string until = profile.getNextChangeDate(change);
+    for (auto& pair : cache) {
+        if (pair.first >= change.date && (until.empty() || pair.first < until)) {
+            pair.second.hasTarget = false;
+        }
+    }
+}
+
+void FoodTracker::syncRevisions() const {
+    // Changes made without a notification (loads, replay while detached)
+    if (log.getRevision() != logRevision) {
+        for (auto& pair : cache) pair.second.hasConsumed = false;
+        logRevision = log.getRevision();
+    }
+    if (profile.getRevision() != profileRevision) {
+        for (auto& pair : cache) pair.second.hasTarget = false;
+        profileRevision = profile.getRevision();
+    }
+}
+
+DaySummary FoodTracker::getSummary(const std::string& date) const {
+    syncRevisions();
+    
+    auto inserted = cache.emplace(date, CachedDay{0.0, 0.0, false, false});
+    CachedDay& day = inserted.first->second;
+    if (!day.hasTarget) {
+        day.target = profile.getTargetCalories(date);
+        day.hasTarget = true;
+    }
+    if (!day.hasConsumed) {
+        const DayLog* dayLog = log.findDayLog(date);
+        day.consumed = dayLog ? dayLog->getTotalCalories() : 0.0;
+        day.hasConsumed = true;
+    }
+    return DaySummary{day.target, day.consumed, day.consumed - day.target};
+}
+
 void FoodTracker::displayDailySummary() const {
+    YADA_TIME_SCOPE(DailySummary);
     std::string date = log.getCurrentDate();
     std::cout << "\n===== Daily Summary for " << date << " =====\n";
     
-    double targetCalories = profile.getTargetCalories(date);
-    double consumedCalories = log.getCurrentDayLog().getTotalCalories();
-    double difference = consumedCalories - targetCalories;
+    DaySummary summary = getSummary(date);
+    double targetCalories = summary.targetCalories;
+    double consumedCalories = summary.consumedCalories;
+    double difference = summary.difference;
     
     std::cout << "Target Calories: " << std::fixed << std::setprecision(1) << targetCalories << std::endl;
     std::cout << "Consumed Calories: " << std::fixed << std::setprecision(1) << consumedCalories << std::endl;
@@ -36,4 +112,4 @@ void FoodTracker::displayDailySummary() const {
         std::cout << " (exactly on target)";
     }
     std::cout << std::endl;
-}
\ No newline at end of file
+}
@@ -6,19 +6,47 @@
 #include "DietProfile.hpp"
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <unordered_map>
+
+// Calorie summary of one date
+struct DaySummary {
+    double targetCalories;
+    double consumedCalories;
+    double difference;
+};
 
 // FoodTracker class that implements Observer
 class FoodTracker : public Observer {
 private:
+    // Targets and consumed calories are cached separately because they are
+    // invalidated by different changes
+    struct CachedDay {
+        double target;
+        double consumed;
+        bool hasTarget;
+        bool hasConsumed;
+    };
+    
     DailyLog& log;
     DietProfile& profile;
+    mutable std::unordered_map<std::string, CachedDay> cache;
+    // Revisions the cache reflects; a gap means a change was missed
+    // (e.g. while detached or on reload) and the cache is dropped
+    mutable uint64_t logRevision;
+    mutable uint64_t profileRevision;
+    
+    void applyLogChange();
+    void applyProfileChange();
+    void syncRevisions() const;
     
 public:
     FoodTracker(DailyLog& l, DietProfile& p);
     ~FoodTracker();
     
     void update(Subject* subject = nullptr) override;
+    DaySummary getSummary(const std::string& date) const;
     void displayDailySummary() const;
 };
 
-#endif // FOOD_TRACKER_HPP
\ No newline at end of file
+#endif // FOOD_TRACKER_HPP
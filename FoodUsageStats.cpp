@@ -0,0 +1,185 @@
+#include "FoodUsageStats.hpp"
+#include "DailyLog.hpp"
+#include "Dates.hpp"
+#include "TextWriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+const double FoodUsageStats::HALF_LIFE_DAYS = 30.0;
+
+namespace {
+    const double DECAY_PER_DAY = std::log(2.0) / FoodUsageStats::HALF_LIFE_DAYS;
+    
+    // log(exp(a) + exp(b)) without overflow
+    double logAdd(double a, double b) {
+        double high = std::max(a, b);
+        return high + std::log1p(std::exp(-std::fabs(a - b)));
+    }
+}
+
+FoodUsageStats::FoodUsageStats() : usageFile("usage.txt") {}
+
+void FoodUsageStats::setUsageFile(const std::string& file) {
+    usageFile = file;
+}
+
+void FoodUsageStats::index(Symbol food, const UsageRecord& record) {
+    byScore.insert(std::make_pair(record.logScore, food));
+    byRecency.insert(std::make_pair(record.lastDay, food));
+}
+
+void FoodUsageStats::unindex(Symbol food, const UsageRecord& record) {
+    byScore.erase(std::make_pair(record.logScore, food));
+    byRecency.erase(std::make_pair(record.lastDay, food));
+}
+
+void FoodUsageStats::recordUse(const std::string& foodId, const std::string& date) {
+    long day;
+    if (!parseDayNumber(date, day)) {
+        return;
+    }
+    Symbol food = SymbolTable::getInstance()->intern(foodId);
+    double weight = DECAY_PER_DAY * day;
+    
+    auto it = records.find(food);
+    if (it == records.end()) {
+        UsageRecord record{1, weight, day};
+        records[food] = record;
+        index(food, record);
+        return;
+    }
+    
+    UsageRecord& record = it->second;
+    unindex(food, record);
+    ++record.count;
+    record.logScore = logAdd(record.logScore, weight);
+    record.lastDay = std::max(record.lastDay, day);
+    index(food, record);
+}
+
+void FoodUsageStats::revertUse(const std::string& foodId, const std::string& date) {
+    Symbol food;
+    long day;
+    if (!SymbolTable::getInstance()->find(foodId, food) || !parseDayNumber(date, day)) {
+        return;
+    }
+    auto it = records.find(food);
+    if (it == records.end()) {
+        return;
+    }
+    
+    UsageRecord& record = it->second;
+    unindex(food, record);
+    if (record.count <= 1) {
+        records.erase(it);
+        return;
+    }
+    --record.count;
+    // log(exp(score) - exp(weight)); rounding can leave nothing to subtract
+    double remaining = 1.0 - std::exp(DECAY_PER_DAY * day - record.logScore);
+    if (remaining > 1e-12) {
+        record.logScore += std::log(remaining);
+    }
+    // The previous last day is not kept, so recency stays at the newest use
+    index(food, record);
+}
+
+uint32_t FoodUsageStats::getUseCount(const std::string& foodId) const {
+    Symbol food;
+    if (!SymbolTable::getInstance()->find(foodId, food)) {
+        return 0;
+    }
+    auto it = records.find(food);
+    return it != records.end() ? it->second.count : 0;
+}
+
+std::vector<std::string> FoodUsageStats::getFavorites(size_t n) const {
+    std::vector<std::string> ids;
+    for (auto it = byScore.begin(); it != byScore.end() && ids.size() < n; ++it) {
+        ids.push_back(SymbolTable::getInstance()->getString(it->second));
+    }
+    return ids;
+}
+
+std::vector<std::string> FoodUsageStats::getRecent(size_t n) const {
+    std::vector<std::string> ids;
+    for (auto it = byRecency.begin(); it != byRecency.end() && ids.size() < n; ++it) {
+        ids.push_back(SymbolTable::getInstance()->getString(it->second));
+    }
+    return ids;
+}
+
+void FoodUsageStats::rebuild(const DailyLog& log) {
+    clear();
+    log.forEachDay([this](const std::string& date, const DayLog& dayLog) {
+        for (const auto& entry : dayLog.getEntries()) {
+            recordUse(entry.food->getIdentifier(), date);
+        }
+    });
+}
+
+void FoodUsageStats::clear() {
+    records.clear();
+    byScore.clear();
+    byRecency.clear();
+}
+
+size_t FoodUsageStats::size() const {
+    return records.size();
+}
+
+bool FoodUsageStats::load() {
+    clear();
+    std::ifstream file(usageFile);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    // Format: foodId;count;logScore;lastDate
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find(';');
+        size_t second = line.find(';', first + 1);
+        size_t third = line.find(';', second + 1);
+        if (first == std::string::npos || second == std::string::npos || third == std::string::npos) {
+            continue;
+        }
+        UsageRecord record;
+        record.count = static_cast<uint32_t>(std::strtoul(line.c_str() + first + 1, nullptr, 10));
+        record.logScore = std::strtod(line.c_str() + second + 1, nullptr);
+        if (record.count == 0 || !parseDayNumber(line.substr(third + 1), record.lastDay)) {
+            continue;
+        }
+        Symbol food = SymbolTable::getInstance()->intern(line.substr(0, first));
+        auto it = records.find(food);
+        if (it != records.end()) {
+            unindex(food, it->second);
+        }
+        records[food] = record;
+        index(food, record);
+    }
+    return true;
+}
+
+bool FoodUsageStats::save() {
+    std::ofstream file(usageFile);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    TextWriter out(&file);
+    char score[32];
+    for (const auto& entry : byScore) {
+        const UsageRecord& record = records.at(entry.second);
+        // Full precision; the score is a large log-domain value
+        std::snprintf(score, sizeof(score), "%.17g", record.logScore);
+        out << SymbolTable::getInstance()->getString(entry.second) << ";"
+            << static_cast<size_t>(record.count) << ";" << score << ";"
+            << formatDayNumber(record.lastDay) << '\n';
+    }
+    out.flush();
+    return static_cast<bool>(file);
+}
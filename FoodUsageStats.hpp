@@ -0,0 +1,62 @@
+#ifndef FOOD_USAGE_STATS_HPP
+#define FOOD_USAGE_STATS_HPP
+
+#include "SymbolTable.hpp"
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class DailyLog;
+
+// How often and how recently a user logs each food.
+// Every use adds exp(-ln2 * age / HALF_LIFE_DAYS) to a food's score. The
+// score is kept in the log domain relative to day 0 (log of the sum of
+// exp(lambda * day)), so scores never need to be decayed as time passes and
+// stay comparable between foods. Ordered views give the top N in O(k).
+class FoodUsageStats {
+private:
+    struct UsageRecord {
+        uint32_t count;
+        double logScore;
+        long lastDay;
+    };
+    
+    std::unordered_map<Symbol, UsageRecord> records;
+    std::set<std::pair<double, Symbol>, std::greater<std::pair<double, Symbol>>> byScore;
+    std::set<std::pair<long, Symbol>, std::greater<std::pair<long, Symbol>>> byRecency;
+    std::string usageFile;
+    
+    void index(Symbol food, const UsageRecord& record);
+    void unindex(Symbol food, const UsageRecord& record);
+    
+public:
+    static const double HALF_LIFE_DAYS;
+    
+    FoodUsageStats();
+    
+    void setUsageFile(const std::string& file);
+    
+    void recordUse(const std::string& foodId, const std::string& date);
+    // Takes back a use recorded for the same date (e.g. on undo)
+    void revertUse(const std::string& foodId, const std::string& date);
+    uint32_t getUseCount(const std::string& foodId) const;
+    
+    // Highest decayed score first
+    std::vector<std::string> getFavorites(size_t n) const;
+    // Most recently logged first
+    std::vector<std::string> getRecent(size_t n) const;
+    
+    // Recounts every entry of the log (pages in all days)
+    void rebuild(const DailyLog& log);
+    void clear();
+    size_t size() const;
+    
+    bool load();
+    bool save();
+};
+
+#endif // FOOD_USAGE_STATS_HPP
@@ -0,0 +1,109 @@
+#include "FuzzyIndex.hpp"
+#include <algorithm>
+
+void FuzzyIndex::assign(std::vector<std::string> newTerms) {
+    std::sort(newTerms.begin(), newTerms.end());
+    newTerms.erase(std::unique(newTerms.begin(), newTerms.end()), newTerms.end());
+    terms.swap(newTerms);
+}
+
+void FuzzyIndex::findWithin(const std::string& query, size_t maxDistance,
+                            std::vector<std::pair<uint32_t, size_t>>& matches) const {
+    if (terms.empty()) {
+        return;
+    }
+    // rows[d] is the DP row for the current prefix of length d
+    std::vector<std::vector<size_t>> rows(1, std::vector<size_t>(query.size() + 1));
+    for (size_t j = 0; j <= query.size(); ++j) {
+        rows[0][j] = j;
+    }
+    walk(query, maxDistance, 0, terms.size(), 0, rows, matches);
+}
+
+void FuzzyIndex::walk(const std::string& query, size_t maxDistance, size_t begin, size_t end, size_t depth,
+                      std::vector<std::vector<size_t>>& rows,
+                      std::vector<std::pair<uint32_t, size_t>>& matches) const {
+    // All terms in [begin, end) share the prefix of length depth; if one
+    // of them is exactly that prefix it sorts first
+    if (terms[begin].size() == depth) {
+        if (rows[depth][query.size()] <= maxDistance) {
+            matches.push_back(std::make_pair(static_cast<uint32_t>(begin), rows[depth][query.size()]));
+        }
+        ++begin;
+    }
+    if (rows.size() <= depth + 1) {
+        rows.push_back(std::vector<size_t>(query.size() + 1));
+    }
+    
+    while (begin < end) {
+        char c = terms[begin][depth];
+        size_t next = std::partition_point(terms.begin() + begin, terms.begin() + end,
+            [depth, c](const std::string& term) { return term[depth] == c; }) - terms.begin();
+        
+        const std::vector<size_t>& previous = rows[depth];
+        std::vector<size_t>& current = rows[depth + 1];
+        current[0] = depth + 1;
+        size_t smallest = current[0];
+        for (size_t j = 1; j <= query.size(); ++j) {
+            size_t substitution = previous[j - 1] + (query[j - 1] != c ? 1 : 0);
+            current[j] = std::min(substitution, std::min(previous[j], current[j - 1]) + 1);
+            smallest = std::min(smallest, current[j]);
+        }
+        if (smallest <= maxDistance) {
+            walk(query, maxDistance, begin, next, depth + 1, rows, matches);
+        }
+        begin = next;
+    }
+}
+
+bool FuzzyIndex::find(const std::string& term, uint32_t& index) const {
+    auto pos = std::lower_bound(terms.begin(), terms.end(), term);
+    if (pos == terms.end() || *pos != term) {
+        return false;
+    }
+    index = static_cast<uint32_t>(pos - terms.begin());
+    return true;
+}
+
+const std::string& FuzzyIndex::getTerm(uint32_t index) const {
+    return terms[index];
+}
+
+size_t FuzzyIndex::size() const {
+    return terms.size();
+}
+
+void FuzzyIndex::clear() {
+    terms.clear();
+}
+
+size_t FuzzyIndex::editDistance(const std::string& a, const std::string& b) {
+    // Two-row dynamic programming over the shorter string
+    const std::string& shorter = a.size() <= b.size() ? a : b;
+    const std::string& longer = a.size() <= b.size() ? b : a;
+    
+    // Terms are short, so the rows normally live on the stack
+    const size_t STACK_ROW = 64;
+    size_t stackRows[2 * STACK_ROW];
+    std::vector<size_t> heapRows;
+    size_t* previous = stackRows;
+    size_t* current = stackRows + STACK_ROW;
+    if (shorter.size() + 1 > STACK_ROW) {
+        heapRows.resize(2 * (shorter.size() + 1));
+        previous = heapRows.data();
+        current = previous + shorter.size() + 1;
+    }
+    
+    for (size_t j = 0; j <= shorter.size(); ++j) {
+        previous[j] = j;
+    }
+    for (size_t i = 1; i <= longer.size(); ++i) {
+        current[0] = i;
+        for (size_t j = 1; j <= shorter.size(); ++j) {
+            size_t substitution = previous[j - 1] + (longer[i - 1] != shorter[j - 1] ? 1 : 0);
+            current[j] = std::min(substitution, std::min(previous[j], current[j - 1]) + 1);
+        }
+        std::swap(previous, current);
+    }
+    return previous[shorter.size()];
+}
@@ -0,0 +1,40 @@
+#ifndef FUZZY_INDEX_HPP
+#define FUZZY_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Typo-tolerant lookup over a sorted term dictionary.
+// The sorted terms form an implicit trie (terms sharing a prefix are
+// contiguous), which is walked while carrying one Levenshtein DP row per
+// prefix - the same as running a Levenshtein automaton against the
+// dictionary. A prefix is abandoned as soon as every cell of its row
+// exceeds the allowed distance, so only terms near the query are visited.
+class FuzzyIndex {
+private:
+    std::vector<std::string> terms;
+    
+    void walk(const std::string& query, size_t maxDistance, size_t begin, size_t end, size_t depth,
+              std::vector<std::vector<size_t>>& rows, std::vector<std::pair<uint32_t, size_t>>& matches) const;
+    
+public:
+    // Replaces the dictionary; terms are sorted and deduplicated, and a
+    // term's index is its position in that order
+    void assign(std::vector<std::string> newTerms);
+    // Appends (term index, distance) for every term within maxDistance of query
+    void findWithin(const std::string& query, size_t maxDistance,
+                    std::vector<std::pair<uint32_t, size_t>>& matches) const;
+    
+    // Sets index to term's position; false if term is not in the dictionary
+    bool find(const std::string& term, uint32_t& index) const;
+    const std::string& getTerm(uint32_t index) const;
+    size_t size() const;
+    void clear();
+    
+    static size_t editDistance(const std::string& a, const std::string& b);
+};
+
+#endif // FUZZY_INDEX_HPP
@@ -0,0 +1,267 @@
+#include "KeywordScanner.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define YADA_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Needle {
+    const char* text;
+    size_t size;  // >= 1, no '\0'
+    size_t slot;  // Which result it fills
+    // End of the last string it was found in; further hits there change nothing
+    size_t skipUntil;
+};
+
+struct NeedleSet {
+    std::vector<Needle> needles;
+    // Needles by first byte, for scanTail()
+    std::vector<size_t> byFirst[256];
+    size_t longest;
+};
+
+// Maps hit positions to strings, remembering the last string so runs of
+// hits in one string need no search
+class HitMarker {
+private:
+    const std::vector<uint32_t>& offsets;
+    std::vector<std::vector<bool>>& matches;
+    size_t current;
+    size_t begin;
+    size_t end;
+
+public:
+    HitMarker(const std::vector<uint32_t>& o, std::vector<std::vector<bool>>& m)
+        : offsets(o), matches(m), current(0), begin(0), end(0) {}
+
+    // Returns where the string containing position ends
+    size_t mark(size_t slot, size_t position) {
+        if (position < begin || position >= end) {
+            current = std::upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin() - 1;
+            begin = offsets[current];
+            end = current + 1 < offsets.size() ? offsets[current + 1] : static_cast<size_t>(-1);
+        }
+        matches[slot][current] = true;
+        return end;
+    }
+};
+
+// Each kernel reports every position in data[from, size) where one of the
+// needles starts, in one pass over the data
+typedef void (*ScanFunction)(const char* data, size_t size, size_t from, NeedleSet& set, HitMarker& marker);
+
+// One needle from position from, skipping ahead with memchr
+void scanOne(const char* data, size_t size, size_t from, Needle& needle, HitMarker& marker) {
+    size_t i = std::max(from, needle.skipUntil);
+    while (i < size && needle.size <= size - i) {
+        const char* p = static_cast<const char*>(std::memchr(data + i, needle.text[0], size - needle.size + 1 - i));
+        if (!p) {
+            return;
+        }
+        i = p - data;
+        if (std::memcmp(p + 1, needle.text + 1, needle.size - 1) == 0) {
+            i = needle.skipUntil = marker.mark(needle.slot, i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Byte by byte, every needle starting with that byte; finishes the vector
+// kernels' last partial blocks
+void scanTail(const char* data, size_t size, size_t from, NeedleSet& set, HitMarker& marker) {
+    for (size_t i = from; i < size; ++i) {
+        for (size_t k : set.byFirst[static_cast<unsigned char>(data[i])]) {
+            Needle& needle = set.needles[k];
+            if (i >= needle.skipUntil && needle.size <= size - i &&
+                std::memcmp(data + i + 1, needle.text + 1, needle.size - 1) == 0) {
+                needle.skipUntil = marker.mark(needle.slot, i);
+            }
+        }
+    }
+}
+
+// Without vector instructions a memchr pass per needle beats one
+// byte-by-byte pass for all of them
+void scanScalar(const char* data, size_t size, size_t from, NeedleSet& set, HitMarker& marker) {
+    for (Needle& needle : set.needles) {
+        scanOne(data, size, from, needle, marker);
+    }
+}
+
+#ifdef YADA_SCAN_X86
+// Per block, each needle's first and last characters are compared against
+// 16 positions at once and only the middle of candidates is checked
+__attribute__((target("sse2")))
+void scanSse2(const char* data, size_t size, size_t from, NeedleSet& set, HitMarker& marker) {
+    size_t i = from;
+    // Every needle's loads stay inside the buffer, as does checking any candidate
+    for (; i + set.longest - 1 + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        for (Needle& needle : set.needles) {
+            if (needle.skipUntil >= i + 16) {
+                continue;
+            }
+            size_t n = needle.size;
+            __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + n - 1));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(needle.text[0])),
+                              _mm_cmpeq_epi8(blockLast, _mm_set1_epi8(needle.text[n - 1])))));
+            if (needle.skipUntil > i) {
+                mask &= ~0u << (needle.skipUntil - i);
+            }
+            while (mask) {
+                unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+                if (n <= 2 || std::memcmp(data + i + bit + 1, needle.text + 1, n - 2) == 0) {
+                    needle.skipUntil = marker.mark(needle.slot, i + bit);
+                    if (needle.skipUntil >= i + 16) {
+                        break;
+                    }
+                    mask &= ~0u << (needle.skipUntil - i);
+                } else {
+                    mask &= mask - 1;
+                }
+            }
+        }
+    }
+    scanTail(data, size, i, set, marker);
+}
+
+__attribute__((target("avx2")))
+void scanAvx2(const char* data, size_t size, size_t from, NeedleSet& set, HitMarker& marker) {
+    size_t i = from;
+    for (; i + set.longest - 1 + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        for (Needle& needle : set.needles) {
+            if (needle.skipUntil >= i + 32) {
+                continue;
+            }
+            size_t n = needle.size;
+            __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + n - 1));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(needle.text[0])),
+                                 _mm256_cmpeq_epi8(blockLast, _mm256_set1_epi8(needle.text[n - 1])))));
+            if (needle.skipUntil > i) {
+                mask &= ~0u << (needle.skipUntil - i);
+            }
+            while (mask) {
+                unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+                if (n <= 2 || std::memcmp(data + i + bit + 1, needle.text + 1, n - 2) == 0) {
+                    needle.skipUntil = marker.mark(needle.slot, i + bit);
+                    if (needle.skipUntil >= i + 32) {
+                        break;
+                    }
+                    mask &= ~0u << (needle.skipUntil - i);
+                } else {
+                    mask &= mask - 1;
+                }
+            }
+        }
+    }
+    scanTail(data, size, i, set, marker);
+}
+#endif
+
+ScanFunction getScanFunction(ScanKernel kernel) {
+#ifdef YADA_SCAN_X86
+    switch (kernel) {
+        case ScanKernel::Avx2: return scanAvx2;
+        case ScanKernel::Sse2: return scanSse2;
+        case ScanKernel::Scalar: break;
+    }
+#else
+    (void)kernel;
+#endif
+    return scanScalar;
+}
+
+} // namespace
+
+KeywordScanner::KeywordScanner() : kernel(getBestKernel()) {}
+
+void KeywordScanner::append(const std::string& text) {
+    offsets.push_back(static_cast<uint32_t>(buffer.size()));
+    buffer += text;
+    buffer += '\0'; // Needles never contain it, so no hit spans two strings
+}
+
+size_t KeywordScanner::size() const {
+    return offsets.size();
+}
+
+void KeywordScanner::clear() {
+    buffer.clear();
+    offsets.clear();
+}
+
+std::vector<bool> KeywordScanner::findContaining(const std::string& needle) const {
+    return findContainingAll(std::vector<std::string>(1, needle))[0];
+}
+
+std::vector<std::vector<bool>> KeywordScanner::findContainingAll(const std::vector<std::string>& needles) const {
+    std::vector<std::vector<bool>> matches;
+    NeedleSet set;
+    set.longest = 0;
+    for (size_t k = 0; k < needles.size(); ++k) {
+        const std::string& needle = needles[k];
+        matches.push_back(std::vector<bool>(offsets.size(), needle.empty()));
+        if (needle.empty() || needle.find('\0') != std::string::npos) {
+            continue;
+        }
+        set.byFirst[static_cast<unsigned char>(needle[0])].push_back(set.needles.size());
+        set.needles.push_back(Needle{needle.data(), needle.size(), k, 0});
+        set.longest = std::max(set.longest, needle.size());
+    }
+    if (set.needles.empty() || buffer.empty()) {
+        return matches;
+    }
+
+    HitMarker marker(offsets, matches);
+    getScanFunction(kernel)(buffer.data(), buffer.size(), 0, set, marker);
+    return matches;
+}
+
+bool KeywordScanner::setKernel(ScanKernel newKernel) {
+    if (!isSupported(newKernel)) {
+        return false;
+    }
+    kernel = newKernel;
+    return true;
+}
+
+ScanKernel KeywordScanner::getKernel() const {
+    return kernel;
+}
+
+bool KeywordScanner::isSupported(ScanKernel kernel) {
+    switch (kernel) {
+#ifdef YADA_SCAN_X86
+        case ScanKernel::Avx2: return __builtin_cpu_supports("avx2");
+        case ScanKernel::Sse2: return __builtin_cpu_supports("sse2");
+#else
+        case ScanKernel::Avx2:
+        case ScanKernel::Sse2: return false;
+#endif
+        case ScanKernel::Scalar: return true;
+    }
+    return false;
+}
+
+ScanKernel KeywordScanner::getBestKernel() {
+    static const ScanKernel best = isSupported(ScanKernel::Avx2) ? ScanKernel::Avx2 :
+                                   (isSupported(ScanKernel::Sse2) ? ScanKernel::Sse2 : ScanKernel::Scalar);
+    return best;
+}
+
+const char* KeywordScanner::getKernelName(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::Avx2: return "avx2";
+        case ScanKernel::Sse2: return "sse2";
+        case ScanKernel::Scalar: return "scalar";
+    }
+    return "unknown";
+}
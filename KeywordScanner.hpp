@@ -0,0 +1,51 @@
+#ifndef KEYWORD_SCANNER_HPP
+#define KEYWORD_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Substring search kernels, fastest supported one picked at runtime
+enum class ScanKernel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Substring scan over a packed vocabulary.
+// All strings live in one buffer, separated by '\0', with the start of each
+// in offsets; all needles are searched across the whole buffer in one pass
+// and every hit is mapped back to its string by binary search on the
+// offsets. Per block of 16 or 32 positions, the vector kernels compare each
+// needle's first and last characters against the whole block at once and
+// only check the middle of candidates. The portable kernel runs memchr once
+// per needle instead.
+class KeywordScanner {
+private:
+    std::string buffer;
+    std::vector<uint32_t> offsets;
+    ScanKernel kernel;
+
+public:
+    KeywordScanner();
+
+    // Adds a string; its index is the number of strings added before it
+    void append(const std::string& text);
+    size_t size() const;
+    void clear();
+
+    // Marks every string containing needle; an empty needle matches all
+    std::vector<bool> findContaining(const std::string& needle) const;
+    // One mask per needle, as findContaining() would give, from one scan
+    std::vector<std::vector<bool>> findContainingAll(const std::vector<std::string>& needles) const;
+
+    // Kernels the CPU doesn't support are refused (returns false)
+    bool setKernel(ScanKernel newKernel);
+    ScanKernel getKernel() const;
+    static bool isSupported(ScanKernel kernel);
+    static ScanKernel getBestKernel();
+    static const char* getKernelName(ScanKernel kernel);
+};
+
+#endif // KEYWORD_SCANNER_HPP
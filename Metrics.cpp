@@ -0,0 +1,229 @@
+#include "Metrics.hpp"
+#include "TextWriter.hpp"
+#include <cstdio>
+
+namespace {
+    // Single-writer update; other threads only read
+    inline void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    
+    inline size_t highestBit(uint64_t value) {
+        size_t bit = 0;
+        while (value >>= 1) ++bit;
+        return bit;
+    }
+}
+
+const size_t LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() : count(0), totalNs(0) {
+    for (size_t i = 0; i < BUCKETS; ++i) buckets[i] = 0;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) buckets[i] += other.buckets[i];
+    count += other.count;
+    totalNs += other.totalNs;
+}
+
+void LatencyHistogram::subtract(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; ++i) buckets[i] -= other.buckets[i];
+    count -= other.count;
+    totalNs -= other.totalNs;
+}
+
+size_t LatencyHistogram::bucketFor(uint64_t ns) {
+    if (ns < 16) {
+        return static_cast<size_t>(ns);
+    }
+    size_t exponent = highestBit(ns);
+    size_t sub = static_cast<size_t>(ns >> (exponent - 2)) & 3;
+    return 16 + (exponent - 4) * 4 + sub;
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(size_t bucket) {
+    if (bucket < 16) {
+        return bucket;
+    }
+    size_t exponent = (bucket - 16) / 4 + 4;
+    uint64_t sub = (bucket - 16) % 4;
+    uint64_t width = uint64_t(1) << (exponent - 2);
+    return (4 + sub) * width + width / 2;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return bucketMidpoint(i);
+        }
+    }
+    return bucketMidpoint(BUCKETS - 1);
+}
+
+MetricsSnapshot::MetricsSnapshot() {
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) counters[i] = 0;
+}
+
+Metrics::ThreadSlot::ThreadSlot() {
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+            buckets[m][b].store(0, std::memory_order_relaxed);
+        }
+        count[m].store(0, std::memory_order_relaxed);
+        totalNs[m].store(0, std::memory_order_relaxed);
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        counters[c].store(0, std::memory_order_relaxed);
+    }
+}
+
+Metrics::Metrics() {}
+
+Metrics* Metrics::getInstance() {
+    // Function-local static: safe to call first from any thread
+    static Metrics* metrics = new Metrics();
+    return metrics;
+}
+
+bool Metrics::isEnabled() {
+#ifdef YADA_ENABLE_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+Metrics::ThreadSlot& Metrics::localSlot() {
+    thread_local ThreadSlot* slot = nullptr;
+    if (!slot) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        slots.emplace_back(new ThreadSlot());
+        slot = slots.back().get();
+    }
+    return *slot;
+}
+
+void Metrics::record(Metric metric, uint64_t ns) {
+    ThreadSlot& slot = localSlot();
+    size_t index = static_cast<size_t>(metric);
+    bump(slot.buckets[index][LatencyHistogram::bucketFor(ns)], 1);
+    bump(slot.count[index], 1);
+    bump(slot.totalNs[index], ns);
+}
+
+void Metrics::increment(Counter counter, uint64_t amount) {
+    bump(localSlot().counters[static_cast<size_t>(counter)], amount);
+}
+
+MetricsSnapshot Metrics::collect() {
+    MetricsSnapshot result;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& slot : slots) {
+        for (size_t m = 0; m < METRIC_COUNT; ++m) {
+            LatencyHistogram& histogram = result.histograms[m];
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                histogram.buckets[b] += slot->buckets[m][b].load(std::memory_order_relaxed);
+            }
+            histogram.count += slot->count[m].load(std::memory_order_relaxed);
+            histogram.totalNs += slot->totalNs[m].load(std::memory_order_relaxed);
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            result.counters[c] += slot->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    MetricsSnapshot result = collect();
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        result.histograms[m].subtract(baseline.histograms[m]);
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        result.counters[c] -= baseline.counters[c];
+    }
+    return result;
+}
+
+void Metrics::reset() {
+    baseline = collect();
+}
+
+void Metrics::writeText(TextWriter& out) {
+    MetricsSnapshot current = snapshot();
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-20s %10s %12s %12s %12s\n", "timer", "count", "mean(us)", "p50(us)", "p99(us)");
+    out << line;
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        const LatencyHistogram& histogram = current.histograms[m];
+        if (histogram.count == 0) continue;
+        
+        std::snprintf(line, sizeof(line), "%-20s %10llu %12.1f %12.1f %12.1f\n",
+                      getMetricName(static_cast<Metric>(m)),
+                      static_cast<unsigned long long>(histogram.count),
+                      histogram.totalNs / 1000.0 / histogram.count,
+                      histogram.percentile(0.5) / 1000.0,
+                      histogram.percentile(0.99) / 1000.0);
+        out << line;
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << getCounterName(static_cast<Counter>(c)) << ": "
+            << static_cast<long long>(current.counters[c]) << "\n";
+    }
+}
+
+void Metrics::writeJson(TextWriter& out) {
+    MetricsSnapshot current = snapshot();
+    out << "{\"enabled\": " << (isEnabled() ? "true" : "false") << ", \"timers\": {";
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        const LatencyHistogram& histogram = current.histograms[m];
+        out << (m ? ", " : "") << "\"" << getMetricName(static_cast<Metric>(m)) << "\": {"
+            << "\"count\": " << static_cast<long long>(histogram.count)
+            << ", \"total_ns\": " << static_cast<long long>(histogram.totalNs)
+            << ", \"p50_ns\": " << static_cast<long long>(histogram.percentile(0.5))
+            << ", \"p99_ns\": " << static_cast<long long>(histogram.percentile(0.99)) << "}";
+    }
+    out << "}, \"counters\": {";
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        out << (c ? ", " : "") << "\"" << getCounterName(static_cast<Counter>(c)) << "\": "
+            << static_cast<long long>(current.counters[c]);
+    }
+    out << "}}\n";
+}
+
+const char* getMetricName(Metric metric) {
+    switch (metric) {
+        case Metric::LoadDatabase: return "load_database";
+        case Metric::SaveDatabase: return "save_database";
+        case Metric::LoadLog: return "load_log";
+        case Metric::SaveLog: return "save_log";
+        case Metric::LoadProfile: return "load_profile";
+        case Metric::SaveProfile: return "save_profile";
+        case Metric::FindFoods: return "find_foods";
+        case Metric::RankedSearch: return "ranked_search";
+        case Metric::FuzzySearch: return "fuzzy_search";
+        case Metric::Autocomplete: return "autocomplete";
+        case Metric::ImportFoods: return "import_foods";
+        case Metric::CommandExecute: return "command_execute";
+        case Metric::CommandUndo: return "command_undo";
+        case Metric::ObserverNotify: return "observer_notify";
+        case Metric::DailySummary: return "daily_summary";
+        default: return "unknown";
+    }
+}
+
+const char* getCounterName(Counter counter) {
+    switch (counter) {
+        case Counter::SearchCacheHit: return "search_cache_hits";
+        case Counter::SearchCacheMiss: return "search_cache_misses";
+        case Counter::CommandsLogged: return "commands_logged";
+        default: return "unknown";
+    }
+}
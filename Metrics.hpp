@@ -0,0 +1,140 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TextWriter;
+
+// Timed hot paths
+enum class Metric : uint8_t {
+    LoadDatabase,
+    SaveDatabase,
+    LoadLog,
+    SaveLog,
+    LoadProfile,
+    SaveProfile,
+    FindFoods,
+    RankedSearch,
+    FuzzySearch,
+    Autocomplete,
+    ImportFoods,
+    CommandExecute,
+    CommandUndo,
+    ObserverNotify,
+    DailySummary,
+    Count
+};
+
+// Plain event counters
+enum class Counter : uint8_t {
+    SearchCacheHit,
+    SearchCacheMiss,
+    CommandsLogged,
+    Count
+};
+
+const size_t METRIC_COUNT = static_cast<size_t>(Metric::Count);
+const size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+// Log-linear latency histogram: exact below 16ns, then 4 buckets per power
+// of two (at most 25% relative error on percentiles).
+struct LatencyHistogram {
+    static const size_t BUCKETS = 256;
+    uint64_t buckets[BUCKETS];
+    uint64_t count;
+    uint64_t totalNs;
+    
+    LatencyHistogram();
+    void merge(const LatencyHistogram& other);
+    void subtract(const LatencyHistogram& other);
+    // Approximate latency at quantile q (0..1) in nanoseconds
+    uint64_t percentile(double q) const;
+    
+    static size_t bucketFor(uint64_t ns);
+    static uint64_t bucketMidpoint(size_t bucket);
+};
+
+struct MetricsSnapshot {
+    LatencyHistogram histograms[METRIC_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+    
+    MetricsSnapshot();
+};
+
+// Collects timings into per-thread slots. Each thread is the only writer of
+// its own slot (relaxed atomic load/store, no read-modify-write), so
+// recording never takes a lock; the registry mutex is only taken when a
+// thread records for the first time and when slots are merged. reset() just
+// remembers a baseline that later snapshots subtract.
+class Metrics {
+private:
+    struct ThreadSlot {
+        std::atomic<uint64_t> buckets[METRIC_COUNT][LatencyHistogram::BUCKETS];
+        std::atomic<uint64_t> count[METRIC_COUNT];
+        std::atomic<uint64_t> totalNs[METRIC_COUNT];
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        
+        ThreadSlot();
+    };
+    
+    std::mutex registryMutex;
+    // Slots outlive their threads so their samples stay in the totals
+    std::vector<std::unique_ptr<ThreadSlot>> slots;
+    MetricsSnapshot baseline;
+    
+    Metrics();
+    ThreadSlot& localSlot();
+    MetricsSnapshot collect();
+    
+public:
+    static Metrics* getInstance();
+    
+    // False when built without YADA_ENABLE_METRICS (the macros below are no-ops)
+    static bool isEnabled();
+    
+    void record(Metric metric, uint64_t ns);
+    void increment(Counter counter, uint64_t amount = 1);
+    MetricsSnapshot snapshot();
+    void reset();
+    
+    void writeText(TextWriter& out);
+    void writeJson(TextWriter& out);
+};
+
+const char* getMetricName(Metric metric);
+const char* getCounterName(Counter counter);
+
+// Records the lifetime of the enclosing scope
+class ScopedTimer {
+private:
+    Metric metric;
+    std::chrono::steady_clock::time_point start;
+    
+public:
+    explicit ScopedTimer(Metric m) : metric(m), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        Metrics::getInstance()->record(metric,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#define YADA_METRICS_CONCAT_INNER(a, b) a##b
+#define YADA_METRICS_CONCAT(a, b) YADA_METRICS_CONCAT_INNER(a, b)
+
+#ifdef YADA_ENABLE_METRICS
+#define YADA_TIME_SCOPE(metric) ScopedTimer YADA_METRICS_CONCAT(yadaScopedTimer, __LINE__)(Metric::metric)
+#define YADA_COUNT(counter) Metrics::getInstance()->increment(Counter::counter)
+#else
+#define YADA_TIME_SCOPE(metric) ((void)0)
+#define YADA_COUNT(counter) ((void)0)
+#endif
+
+#endif // METRICS_HPP
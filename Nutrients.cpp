@@ -0,0 +1,154 @@
+#include "Nutrients.hpp"
+#include <sstream>
+#include <cstdlib>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    struct NutrientInfo {
+        const char* name;
+        const char* unit;
+    };
+    
+    const NutrientInfo nutrientInfo[NUTRIENT_COUNT] = {
+        {"calories", "kcal"},
+        {"protein", "g"},
+        {"fat", "g"},
+        {"carbohydrates", "g"},
+        {"fiber", "g"},
+        {"sodium", "mg"},
+        {"sugar", "g"},
+        {"saturated_fat", "g"},
+        {"cholesterol", "mg"},
+        {"potassium", "mg"},
+        {"calcium", "mg"},
+        {"iron", "mg"},
+        {"magnesium", "mg"},
+        {"phosphorus", "mg"},
+        {"zinc", "mg"},
+        {"copper", "mg"},
+        {"manganese", "mg"},
+        {"selenium", "ug"},
+        {"vitamin_a", "ug"},
+        {"vitamin_c", "mg"},
+        {"vitamin_d", "ug"},
+        {"vitamin_e", "mg"},
+        {"vitamin_k", "ug"},
+        {"thiamin", "mg"},
+        {"riboflavin", "mg"},
+        {"niacin", "mg"},
+        {"vitamin_b6", "mg"},
+        {"folate", "ug"},
+        {"vitamin_b12", "ug"}
+    };
+}
+
+NutrientVector::NutrientVector() {
+    for (size_t i = 0; i < LANES; ++i) {
+        values[i] = 0.0;
+    }
+}
+
+// Vectors outside the food arena may lack 32-byte alignment (no over-aligned
+// new in C++14), so the kernels use unaligned loads; on aligned data they
+// run at full speed.
+void NutrientVector::addScaled(const NutrientVector& other, double factor) {
+#if defined(__AVX__)
+    const __m256d f = _mm256_set1_pd(factor);
+    for (size_t i = 0; i < LANES; i += 4) {
+        __m256d acc = _mm256_loadu_pd(values + i);
+        __m256d src = _mm256_loadu_pd(other.values + i);
+        _mm256_storeu_pd(values + i, _mm256_add_pd(acc, _mm256_mul_pd(src, f)));
+    }
+#elif defined(__SSE2__)
+    const __m128d f = _mm_set1_pd(factor);
+    for (size_t i = 0; i < LANES; i += 2) {
+        __m128d acc = _mm_loadu_pd(values + i);
+        __m128d src = _mm_loadu_pd(other.values + i);
+        _mm_storeu_pd(values + i, _mm_add_pd(acc, _mm_mul_pd(src, f)));
+    }
+#else
+    for (size_t i = 0; i < LANES; ++i) {
+        values[i] += other.values[i] * factor;
+    }
+#endif
+}
+
+NutrientVector& NutrientVector::operator+=(const NutrientVector& other) {
+    addScaled(other, 1.0);
+    return *this;
+}
+
+bool NutrientVector::operator==(const NutrientVector& other) const {
+    for (size_t i = 0; i < NUTRIENT_COUNT; ++i) {
+        if (values[i] != other.values[i]) return false;
+    }
+    return true;
+}
+
+bool NutrientVector::hasNonCalorieValues() const {
+    for (size_t i = 1; i < NUTRIENT_COUNT; ++i) {
+        if (values[i] != 0.0) return true;
+    }
+    return false;
+}
+
+const char* getNutrientName(Nutrient n) {
+    return nutrientInfo[static_cast<size_t>(n)].name;
+}
+
+const char* getNutrientUnit(Nutrient n) {
+    return nutrientInfo[static_cast<size_t>(n)].unit;
+}
+
+bool parseNutrientName(const std::string& name, Nutrient& n) {
+    for (size_t i = 0; i < NUTRIENT_COUNT; ++i) {
+        if (name == nutrientInfo[i].name) {
+            n = static_cast<Nutrient>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string formatNutrientList(const NutrientVector& nutrients) {
+    TextWriter out;
+    writeNutrientList(out, nutrients);
+    return out.str();
+}
+
+void writeNutrientList(TextWriter& out, const NutrientVector& nutrients) {
+    bool first = true;
+    for (size_t i = 1; i < NUTRIENT_COUNT; ++i) {
+        if (nutrients.values[i] == 0.0) continue;
+        if (!first) out << ",";
+        out << nutrientInfo[i].name << "=" << nutrients.values[i];
+        first = false;
+    }
+}
+
+void parseNutrientList(const std::string& text, NutrientVector& nutrients) {
+    std::istringstream iss(text);
+    std::string pair;
+    while (std::getline(iss, pair, ',')) {
+        size_t eq = pair.find('=');
+        if (eq == std::string::npos) continue;
+        
+        std::string name = pair.substr(0, eq);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        
+        std::string valueStr = pair.substr(eq + 1);
+        char* end = nullptr;
+        double value = std::strtod(valueStr.c_str(), &end);
+        
+        Nutrient n;
+        if (end != valueStr.c_str() && parseNutrientName(name, n)) {
+            nutrients.set(n, value);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef NUTRIENTS_HPP
+#define NUTRIENTS_HPP
+
+#include <cstddef>
+#include <string>
+#include "TextWriter.hpp"
+
+// Nutrients tracked per serving. Calories must stay first; the file format
+// stores it in its own field and the remaining ones as name=value pairs.
+enum class Nutrient {
+    Calories,
+    Protein,
+    Fat,
+    Carbohydrates,
+    Fiber,
+    Sodium,
+    Sugar,
+    SaturatedFat,
+    Cholesterol,
+    Potassium,
+    Calcium,
+    Iron,
+    Magnesium,
+    Phosphorus,
+    Zinc,
+    Copper,
+    Manganese,
+    Selenium,
+    VitaminA,
+    VitaminC,
+    VitaminD,
+    VitaminE,
+    VitaminK,
+    Thiamin,
+    Riboflavin,
+    Niacin,
+    VitaminB6,
+    Folate,
+    VitaminB12,
+    Count
+};
+
+const size_t NUTRIENT_COUNT = static_cast<size_t>(Nutrient::Count);
+
+// Fixed-width vector of all nutrients, padded to a multiple of four lanes and
+// aligned so whole vectors can be added with SIMD instructions.
+struct alignas(32) NutrientVector {
+    static const size_t LANES = (NUTRIENT_COUNT + 3) / 4 * 4;
+    
+    double values[LANES];
+    
+    NutrientVector();
+    
+    double get(Nutrient n) const { return values[static_cast<size_t>(n)]; }
+    void set(Nutrient n, double value) { values[static_cast<size_t>(n)] = value; }
+    
+    // this += other * factor, across all lanes at once
+    void addScaled(const NutrientVector& other, double factor);
+    NutrientVector& operator+=(const NutrientVector& other);
+    bool operator==(const NutrientVector& other) const;
+    bool operator!=(const NutrientVector& other) const { return !(*this == other); }
+    bool hasNonCalorieValues() const;
+};
+
+const char* getNutrientName(Nutrient n);
+const char* getNutrientUnit(Nutrient n);
+bool parseNutrientName(const std::string& name, Nutrient& n);
+
+// "protein=31,fat=3.6" style list of the non-zero nutrients other than calories
+std::string formatNutrientList(const NutrientVector& nutrients);
+void writeNutrientList(TextWriter& out, const NutrientVector& nutrients);
+// Parses formatNutrientList() output into nutrients; unknown names and bad values are ignored
+void parseNutrientList(const std::string& text, NutrientVector& nutrients);
+
+#endif // NUTRIENTS_HPP
@@ -1,4 +1,5 @@
 #include "Observer.hpp"
+#include "Metrics.hpp"
 
 void Subject::addObserver(Observer* observer) {
     observers.push_back(observer);
@@ -9,6 +10,7 @@ void Subject::removeObserver(Observer* observer) {
 }
 
 void Subject::notifyObservers() {
+    YADA_TIME_SCOPE(ObserverNotify);
     for (Observer* observer : observers) {
         observer->update(this);
     }
@@ -0,0 +1,88 @@
+#include "PrefixIndex.hpp"
+#include <algorithm>
+
+void PrefixIndex::build(const std::vector<std::string>& sortedTerms) {
+    clear();
+    Node root = {0, 0, 0, static_cast<uint32_t>(sortedTerms.size()), 0, 0};
+    nodes.push_back(root);
+    // Path length of each node, only needed while building
+    std::vector<size_t> depths(1, 0);
+
+    // Breadth first, so each node's children are appended next to each other
+    for (size_t index = 0; index < nodes.size(); ++index) {
+        size_t depth = depths[index];
+        size_t begin = nodes[index].termBegin;
+        size_t end = nodes[index].termEnd;
+        // A term that is exactly this node's path sorts first and ends here
+        if (begin < end && sortedTerms[begin].size() == depth) {
+            ++begin;
+        }
+
+        nodes[index].firstChild = static_cast<uint32_t>(nodes.size());
+        while (begin < end) {
+            char c = sortedTerms[begin][depth];
+            size_t next = std::partition_point(sortedTerms.begin() + begin, sortedTerms.begin() + end,
+                [depth, c](const std::string& term) { return term[depth] == c; }) - sortedTerms.begin();
+
+            // The group shares whatever its first and last terms share; that
+            // whole run becomes one edge instead of a chain of single children
+            const std::string& first = sortedTerms[begin];
+            const std::string& last = sortedTerms[next - 1];
+            size_t limit = std::min(std::min(first.size(), last.size()), depth + 0xFFFF);
+            size_t childDepth = depth + 1;
+            while (childDepth < limit && first[childDepth] == last[childDepth]) {
+                ++childDepth;
+            }
+
+            Node child = {static_cast<uint32_t>(labels.size()), 0, static_cast<uint32_t>(begin),
+                          static_cast<uint32_t>(next), static_cast<uint16_t>(childDepth - depth), 0};
+            labels.append(first, depth, childDepth - depth);
+            nodes.push_back(child);
+            depths.push_back(childDepth);
+            begin = next;
+        }
+        nodes[index].childCount = static_cast<uint16_t>(nodes.size() - nodes[index].firstChild);
+    }
+}
+
+bool PrefixIndex::findRange(const std::string& prefix, size_t& begin, size_t& end) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    size_t index = 0;
+    size_t matched = 0;
+    while (matched < prefix.size()) {
+        const Node& node = nodes[index];
+        unsigned char c = static_cast<unsigned char>(prefix[matched]);
+        // Siblings are in term order, so their first label bytes are sorted
+        auto first = nodes.begin() + node.firstChild;
+        auto last = first + node.childCount;
+        auto child = std::lower_bound(first, last, c, [this](const Node& n, unsigned char value) {
+            return static_cast<unsigned char>(labels[n.labelBegin]) < value;
+        });
+        if (child == last || static_cast<unsigned char>(labels[child->labelBegin]) != c) {
+            return false;
+        }
+        // The prefix may end partway along the edge
+        for (size_t i = 0; i < child->labelLength && matched < prefix.size(); ++i, ++matched) {
+            if (labels[child->labelBegin + i] != prefix[matched]) {
+                return false;
+            }
+        }
+        index = child - nodes.begin();
+    }
+
+    begin = nodes[index].termBegin;
+    end = nodes[index].termEnd;
+    return begin < end;
+}
+
+size_t PrefixIndex::getNodeCount() const {
+    return nodes.size();
+}
+
+void PrefixIndex::clear() {
+    nodes.clear();
+    labels.clear();
+}
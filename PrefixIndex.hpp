@@ -0,0 +1,41 @@
+#ifndef PREFIX_INDEX_HPP
+#define PREFIX_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compact (path-compressed) trie over a sorted term dictionary.
+// Every node covers the contiguous range of terms that start with its
+// path, so a prefix lookup walks at most prefix.size() characters and
+// hands back an index range; the first k completions are then the first
+// k terms of that range. Edge labels are packed into a single buffer and
+// nodes are laid out breadth first with siblings next to each other.
+class PrefixIndex {
+private:
+    struct Node {
+        uint32_t labelBegin;
+        uint32_t firstChild;
+        uint32_t termBegin;
+        uint32_t termEnd;
+        uint16_t labelLength;
+        uint16_t childCount;
+    };
+
+    std::vector<Node> nodes;
+    std::string labels;
+
+public:
+    // Builds the trie over terms, which must be sorted and unique (as
+    // FuzzyIndex keeps them); term indices refer to that order
+    void build(const std::vector<std::string>& sortedTerms);
+    // Sets [begin, end) to the indices of the terms starting with prefix.
+    // Returns false if there are none.
+    bool findRange(const std::string& prefix, size_t& begin, size_t& end) const;
+
+    size_t getNodeCount() const;
+    void clear();
+};
+
+#endif // PREFIX_INDEX_HPP
@@ -0,0 +1,398 @@
+#include "ReportEngine.hpp"
+#include "Dates.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <thread>
+#include <unordered_map>
+
+const size_t ReportEngine::MIN_DAYS_PER_TASK;
+
+namespace {
+    const double KCAL_PER_KG = 7700.0;
+    const long PROJECTION_WINDOW = 30;
+    
+    // Monday of the day's week
+    long weekStart(long dayNumber) {
+        long weekday = ((dayNumber % 7) + 7 + 3) % 7; // 1970-01-01 was a Thursday
+        return dayNumber - weekday;
+    }
+    
+    double round1(double value) {
+        return std::round(value * 10.0) / 10.0;
+    }
+    
+    void writeJsonString(TextWriter& out, const std::string& text) {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+    
+    // JSON has no nan or inf
+    void writeJsonNumber(TextWriter& out, double value) {
+        if (std::isfinite(value)) {
+            out << value;
+        } else {
+            out << "null";
+        }
+    }
+    
+    // A logged day, read in place from the DailyLog
+    struct DayRef {
+        const std::string* date;
+        const DayLog* dayLog;
+    };
+    
+    struct RangeResult {
+        std::vector<ReportDay> days;
+        // Keyed by identifier, so every version of an edited food is one row
+        std::unordered_map<Symbol, FoodContribution> foods;
+    };
+    
+    // Per-day totals for days[begin, end); only reads the days and profile
+    RangeResult evaluateRange(const DietProfile& profile, const std::vector<DayRef>& days, size_t begin, size_t end) {
+        RangeResult result;
+        for (size_t i = begin; i < end; ++i) {
+            const std::string& date = *days[i].date;
+            const DayLog* dayLog = days[i].dayLog;
+            long dayNumber;
+            if (dayLog->getEntries().empty() || !parseDayNumber(date, dayNumber)) {
+                continue;
+            }
+            
+            double consumed = 0.0;
+            for (const auto& entry : dayLog->getEntries()) {
+                double calories = entry.getCalories();
+                consumed += calories;
+                
+                FoodContribution& contribution = result.foods[entry.food->getIdentifierSymbol()];
+                contribution.food = entry.food;
+                contribution.servings += entry.servings;
+                contribution.calories += calories;
+            }
+            
+            ReportDay day;
+            day.date = date;
+            day.dayNumber = dayNumber;
+            day.consumed = consumed;
+            day.target = profile.getTargetCalories(date);
+            day.difference = consumed - day.target;
+            day.rolling7 = 0.0;
+            day.rolling30 = 0.0;
+            result.days.push_back(day);
+        }
+        return result;
+    }
+    
+    class PeriodAccumulator {
+    private:
+        std::vector<ReportPeriod>& periods;
+        ReportPeriod current;
+        
+    public:
+        explicit PeriodAccumulator(std::vector<ReportPeriod>& out) : periods(out) {
+            current = ReportPeriod{"", 0, 0.0, 0.0, 0.0};
+        }
+        
+        void add(const std::string& label, const ReportDay& day) {
+            if (label != current.label) {
+                finish();
+                current = ReportPeriod{label, 0, 0.0, 0.0, 0.0};
+            }
+            ++current.days;
+            current.averageConsumed += day.consumed;
+            current.averageTarget += day.target;
+            current.averageDifference += day.difference;
+        }
+        
+        void finish() {
+            if (current.days == 0) return;
+            current.averageConsumed /= current.days;
+            current.averageTarget /= current.days;
+            current.averageDifference /= current.days;
+            periods.push_back(current);
+            current.days = 0;
+        }
+    };
+    
+    void writeStreakText(TextWriter& out, const char* label, const ReportStreak& streak) {
+        out << label << ": ";
+        if (streak.length == 0) {
+            out << "none\n";
+        } else {
+            out << streak.length << " day(s) (" << streak.start << " to " << streak.end << ")\n";
+        }
+    }
+    
+    void writeStreakJson(TextWriter& out, const ReportStreak& streak) {
+        out << "{\"length\": " << streak.length << ", \"start\": ";
+        writeJsonString(out, streak.start);
+        out << ", \"end\": ";
+        writeJsonString(out, streak.end);
+        out << "}";
+    }
+    
+    void writePeriodsJson(TextWriter& out, const std::vector<ReportPeriod>& periods) {
+        out << "[";
+        for (size_t i = 0; i < periods.size(); ++i) {
+            const ReportPeriod& period = periods[i];
+            out << (i ? ",\n    " : "\n    ") << "{\"period\": ";
+            writeJsonString(out, period.label);
+            out << ", \"days\": " << period.days << ", \"average_consumed\": ";
+            writeJsonNumber(out, period.averageConsumed);
+            out << ", \"average_target\": ";
+            writeJsonNumber(out, period.averageTarget);
+            out << ", \"average_difference\": ";
+            writeJsonNumber(out, period.averageDifference);
+            out << "}";
+        }
+        out << (periods.empty() ? "]" : "\n  ]");
+    }
+}
+
+ReportEngine::ReportEngine(const DailyLog& l, const DietProfile& p, size_t threads)
+    : log(l), profile(p), threadCount(threads) {}
+
+Report ReportEngine::build(size_t topFoodCount) const {
+    // Pages every day in before the worker threads read them
+    std::vector<DayRef> days;
+    log.forEachDay([&days](const std::string& date, const DayLog& dayLog) {
+        days.push_back(DayRef{&date, &dayLog});
+    });
+    
+    // Split the sorted days into contiguous ranges, one task each
+    size_t threads = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    size_t tasks = std::max<size_t>(1, std::min(threads, days.size() / MIN_DAYS_PER_TASK));
+    size_t perTask = (days.size() + tasks - 1) / std::max<size_t>(1, tasks);
+    
+    std::vector<std::future<RangeResult>> futures;
+    for (size_t t = 1; t < tasks; ++t) {
+        size_t begin = std::min(days.size(), t * perTask);
+        size_t end = std::min(days.size(), begin + perTask);
+        futures.push_back(std::async(std::launch::async, evaluateRange,
+                                     std::cref(profile), std::cref(days), begin, end));
+    }
+    std::vector<RangeResult> ranges;
+    ranges.push_back(evaluateRange(profile, days, 0, std::min(days.size(), perTask)));
+    for (auto& future : futures) {
+        ranges.push_back(future.get());
+    }
+    
+    // Merge in date order
+    Report report;
+    std::unordered_map<Symbol, FoodContribution> foods;
+    for (auto& range : ranges) {
+        report.days.insert(report.days.end(), range.days.begin(), range.days.end());
+        for (const auto& pair : range.foods) {
+            FoodContribution& total = foods[pair.first];
+            total.food = pair.second.food;
+            total.servings += pair.second.servings;
+            total.calories += pair.second.calories;
+        }
+    }
+    
+    // Single pass for rolling windows, periods and streaks
+    report.longestSurplus = ReportStreak{0, "", ""};
+    report.longestDeficit = ReportStreak{0, "", ""};
+    report.currentStreak = ReportStreak{0, "", ""};
+    report.currentStreakIsSurplus = false;
+    
+    PeriodAccumulator weeks(report.weeks);
+    PeriodAccumulator months(report.months);
+    size_t start7 = 0, start30 = 0;
+    double sum7 = 0.0, sum30 = 0.0;
+    ReportStreak streak{0, "", ""};
+    int streakSign = 0;
+    
+    for (size_t i = 0; i < report.days.size(); ++i) {
+        ReportDay& day = report.days[i];
+        
+        sum7 += day.consumed;
+        sum30 += day.consumed;
+        while (report.days[start7].dayNumber <= day.dayNumber - 7) sum7 -= report.days[start7++].consumed;
+        while (report.days[start30].dayNumber <= day.dayNumber - 30) sum30 -= report.days[start30++].consumed;
+        day.rolling7 = sum7 / (i - start7 + 1);
+        day.rolling30 = sum30 / (i - start30 + 1);
+        
+        weeks.add(formatDayNumber(weekStart(day.dayNumber)), day);
+        months.add(day.date.substr(0, 7), day);
+        
+        int sign = day.difference > 0 ? 1 : (day.difference < 0 ? -1 : 0);
+        bool continues = i > 0 && sign != 0 && sign == streakSign &&
+                         day.dayNumber == report.days[i - 1].dayNumber + 1;
+        if (continues) {
+            ++streak.length;
+            streak.end = day.date;
+        } else {
+            streak = sign != 0 ? ReportStreak{1, day.date, day.date} : ReportStreak{0, "", ""};
+            streakSign = sign;
+        }
+        ReportStreak& longest = sign > 0 ? report.longestSurplus : report.longestDeficit;
+        if (sign != 0 && streak.length > longest.length) {
+            longest = streak;
+        }
+    }
+    weeks.finish();
+    months.finish();
+    report.currentStreak = streak;
+    report.currentStreakIsSurplus = streakSign > 0;
+    
+    // Top contributing foods by calories
+    for (const auto& pair : foods) {
+        report.topFoods.push_back(pair.second);
+    }
+    size_t topCount = std::min(topFoodCount, report.topFoods.size());
+    std::partial_sort(report.topFoods.begin(), report.topFoods.begin() + topCount, report.topFoods.end(),
+        [](const FoodContribution& a, const FoodContribution& b) {
+            if (a.calories != b.calories) return a.calories > b.calories;
+            return a.food->getIdentifier() < b.food->getIdentifier();
+        });
+    report.topFoods.resize(topCount);
+    
+    // Weight projection from the recent average surplus/deficit
+    std::string lastDate = report.days.empty() ? log.getCurrentDate() : report.days.back().date;
+    report.currentWeight = profile.getWeight(lastDate);
+    report.recentAverageDifference = 0.0;
+    if (!report.days.empty()) {
+        long since = report.days.back().dayNumber - PROJECTION_WINDOW;
+        double sum = 0.0;
+        int count = 0;
+        for (auto it = report.days.rbegin(); it != report.days.rend() && it->dayNumber > since; ++it) {
+            sum += it->difference;
+            ++count;
+        }
+        report.recentAverageDifference = sum / count;
+    }
+    report.projectedWeight30 = report.currentWeight + report.recentAverageDifference * 30 / KCAL_PER_KG;
+    report.projectedWeight90 = report.currentWeight + report.recentAverageDifference * 90 / KCAL_PER_KG;
+    return report;
+}
+
+void ReportEngine::writeText(const Report& report, TextWriter& out) {
+    if (report.days.empty()) {
+        out << "No logged days to report on.\n";
+        return;
+    }
+    
+    const size_t RECENT_WEEKS = 8;
+    const size_t RECENT_MONTHS = 12;
+    
+    out << "Report for " << report.days.front().date << " to " << report.days.back().date
+        << " (" << report.days.size() << " logged day(s))\n";
+    const ReportDay& last = report.days.back();
+    out << "Rolling average consumed: " << round1(last.rolling7) << " kcal/day (7 days), "
+        << round1(last.rolling30) << " kcal/day (30 days)\n";
+    
+    out << "\nMonthly averages (consumed / target / difference):\n";
+    size_t firstMonth = report.months.size() > RECENT_MONTHS ? report.months.size() - RECENT_MONTHS : 0;
+    for (size_t i = firstMonth; i < report.months.size(); ++i) {
+        const ReportPeriod& month = report.months[i];
+        out << "  " << month.label << ": " << round1(month.averageConsumed) << " / "
+            << round1(month.averageTarget) << " / " << round1(month.averageDifference)
+            << " (" << month.days << " day(s))\n";
+    }
+    
+    out << "\nWeekly averages (consumed / target / difference):\n";
+    size_t firstWeek = report.weeks.size() > RECENT_WEEKS ? report.weeks.size() - RECENT_WEEKS : 0;
+    for (size_t i = firstWeek; i < report.weeks.size(); ++i) {
+        const ReportPeriod& week = report.weeks[i];
+        out << "  Week of " << week.label << ": " << round1(week.averageConsumed) << " / "
+            << round1(week.averageTarget) << " / " << round1(week.averageDifference)
+            << " (" << week.days << " day(s))\n";
+    }
+    
+    out << "\n";
+    writeStreakText(out, "Longest surplus streak", report.longestSurplus);
+    writeStreakText(out, "Longest deficit streak", report.longestDeficit);
+    writeStreakText(out, report.currentStreakIsSurplus ? "Current surplus streak" : "Current deficit streak",
+                    report.currentStreak);
+    
+    out << "\nTop foods by calories:\n";
+    for (size_t i = 0; i < report.topFoods.size(); ++i) {
+        const FoodContribution& food = report.topFoods[i];
+        out << "  " << i + 1 << ". " << food.food->getIdentifier() << ": " << round1(food.calories)
+            << " calories (" << round1(food.servings) << " serving(s))\n";
+    }
+    
+    out << "\nProjected weight (at " << round1(report.recentAverageDifference)
+        << " kcal/day over the last 30 days): " << round1(report.currentWeight) << " kg now, "
+        << round1(report.projectedWeight30) << " kg in 30 days, "
+        << round1(report.projectedWeight90) << " kg in 90 days\n";
+}
+
+void ReportEngine::writeCsv(const Report& report, TextWriter& out) {
+    out << "date,consumed,target,difference,rolling7,rolling30\n";
+    for (const auto& day : report.days) {
+        out << day.date << "," << day.consumed << "," << day.target << "," << day.difference << ","
+            << day.rolling7 << "," << day.rolling30 << "\n";
+    }
+}
+
+void ReportEngine::writeJson(const Report& report, TextWriter& out) {
+    out << "{\n  \"days\": [";
+    for (size_t i = 0; i < report.days.size(); ++i) {
+        const ReportDay& day = report.days[i];
+        out << (i ? ",\n    " : "\n    ") << "{\"date\": ";
+        writeJsonString(out, day.date);
+        out << ", \"consumed\": ";
+        writeJsonNumber(out, day.consumed);
+        out << ", \"target\": ";
+        writeJsonNumber(out, day.target);
+        out << ", \"difference\": ";
+        writeJsonNumber(out, day.difference);
+        out << ", \"rolling7\": ";
+        writeJsonNumber(out, day.rolling7);
+        out << ", \"rolling30\": ";
+        writeJsonNumber(out, day.rolling30);
+        out << "}";
+    }
+    out << (report.days.empty() ? "],\n" : "\n  ],\n");
+    
+    out << "  \"weeks\": ";
+    writePeriodsJson(out, report.weeks);
+    out << ",\n  \"months\": ";
+    writePeriodsJson(out, report.months);
+    
+    out << ",\n  \"streaks\": {\"longest_surplus\": ";
+    writeStreakJson(out, report.longestSurplus);
+    out << ", \"longest_deficit\": ";
+    writeStreakJson(out, report.longestDeficit);
+    out << ", \"current\": ";
+    writeStreakJson(out, report.currentStreak);
+    out << ", \"current_is_surplus\": " << (report.currentStreakIsSurplus ? "true" : "false") << "},\n";
+    
+    out << "  \"top_foods\": [";
+    for (size_t i = 0; i < report.topFoods.size(); ++i) {
+        const FoodContribution& food = report.topFoods[i];
+        out << (i ? ", " : "") << "{\"food\": ";
+        writeJsonString(out, food.food->getIdentifier());
+        out << ", \"servings\": ";
+        writeJsonNumber(out, food.servings);
+        out << ", \"calories\": ";
+        writeJsonNumber(out, food.calories);
+        out << "}";
+    }
+    out << "],\n";
+    
+    out << "  \"projection\": {\"current_weight\": ";
+    writeJsonNumber(out, report.currentWeight);
+    out << ", \"recent_average_difference\": ";
+    writeJsonNumber(out, report.recentAverageDifference);
+    out << ", \"weight_in_30_days\": ";
+    writeJsonNumber(out, report.projectedWeight30);
+    out << ", \"weight_in_90_days\": ";
+    writeJsonNumber(out, report.projectedWeight90);
+    out << "}\n";
+    out << "}\n";
+}
@@ -0,0 +1,84 @@
+#ifndef REPORT_ENGINE_HPP
+#define REPORT_ENGINE_HPP
+
+#include "DailyLog.hpp"
+#include "DietProfile.hpp"
+#include "TextWriter.hpp"
+#include <string>
+#include <vector>
+
+// One logged date
+struct ReportDay {
+    std::string date;
+    long dayNumber;       // days since 1970-01-01
+    double consumed;
+    double target;
+    double difference;    // consumed - target
+    double rolling7;      // average consumed over logged days in the last 7 calendar days
+    double rolling30;     // same over the last 30 calendar days
+};
+
+// Averages over a calendar week (labelled by its Monday) or month (YYYY-MM)
+struct ReportPeriod {
+    std::string label;
+    int days;
+    double averageConsumed;
+    double averageTarget;
+    double averageDifference;
+};
+
+// Consecutive calendar days all over (surplus) or all under (deficit) target
+struct ReportStreak {
+    int length;
+    std::string start;
+    std::string end;
+};
+
+struct FoodContribution {
+    const Food* food;
+    double servings;
+    double calories;
+};
+
+struct Report {
+    std::vector<ReportDay> days;
+    std::vector<ReportPeriod> weeks;
+    std::vector<ReportPeriod> months;
+    ReportStreak longestSurplus;
+    ReportStreak longestDeficit;
+    ReportStreak currentStreak;
+    bool currentStreakIsSurplus;
+    std::vector<FoodContribution> topFoods;
+    // Energy-balance projection from the last 30 days (7700 kcal per kg)
+    double currentWeight;
+    double recentAverageDifference;
+    double projectedWeight30;
+    double projectedWeight90;
+};
+
+// Multi-day trends over the whole log and profile history.
+// Per-day totals (the expensive part: composite walks and target
+// calculations) are evaluated in parallel over contiguous date ranges; the
+// ranges are then merged in date order in one pass that computes rolling
+// averages, period averages and streaks.
+class ReportEngine {
+private:
+    static const size_t MIN_DAYS_PER_TASK = 64;
+    
+    const DailyLog& log;
+    const DietProfile& profile;
+    size_t threadCount;
+    
+public:
+    // threadCount 0 uses the hardware concurrency
+    ReportEngine(const DailyLog& l, const DietProfile& p, size_t threads = 0);
+    
+    Report build(size_t topFoodCount = 10) const;
+    
+    static void writeText(const Report& report, TextWriter& out);
+    // One row per logged date
+    static void writeCsv(const Report& report, TextWriter& out);
+    static void writeJson(const Report& report, TextWriter& out);
+};
+
+#endif // REPORT_ENGINE_HPP
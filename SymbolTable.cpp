@@ -0,0 +1,84 @@
+#include "SymbolTable.hpp"
+#include "TextNormalizer.hpp"
+
+// Initialize the static instances
+SymbolTable* SymbolTable::instance = nullptr;
+SymbolTable* SymbolTable::keywordTable = nullptr;
+const Symbol SymbolTable::NOT_FOLDED;
+
+SymbolTable::SymbolTable(bool scan) : scanned(scan) {}
+
+SymbolTable* SymbolTable::getInstance() {
+    if (!instance) {
+        instance = new SymbolTable(false);
+    }
+    return instance;
+}
+
+SymbolTable* SymbolTable::getKeywordTable() {
+    if (!keywordTable) {
+        keywordTable = new SymbolTable(true);
+    }
+    return keywordTable;
+}
+
+Symbol SymbolTable::intern(const std::string& str) {
+    auto it = ids.find(str);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    
+    Symbol symbol = static_cast<Symbol>(strings.size());
+    auto inserted = ids.emplace(str, symbol).first;
+    strings.push_back(&inserted->first);
+    if (scanned) {
+        scanner.append(str);
+    }
+    return symbol;
+}
+
+bool SymbolTable::find(const std::string& str, Symbol& symbol) const {
+    auto it = ids.find(str);
+    if (it == ids.end()) {
+        return false;
+    }
+    symbol = it->second;
+    return true;
+}
+
+const std::string& SymbolTable::getString(Symbol symbol) const {
+    return *strings[symbol];
+}
+
+Symbol SymbolTable::getFolded(Symbol symbol) {
+    if (symbol < folded.size() && folded[symbol] != NOT_FOLDED) {
+        return folded[symbol];
+    }
+    Symbol result = intern(foldText(*strings[symbol]));
+    folded.resize(strings.size(), NOT_FOLDED);
+    folded[symbol] = result;
+    folded[result] = result; // Folding is idempotent
+    return result;
+}
+
+Symbol SymbolTable::getFoldedKeyword(Symbol symbol) {
+    if (symbol < foldedKeywords.size() && foldedKeywords[symbol] != NOT_FOLDED) {
+        return foldedKeywords[symbol];
+    }
+    Symbol result = getKeywordTable()->intern(foldText(*strings[symbol]));
+    foldedKeywords.resize(strings.size(), NOT_FOLDED);
+    foldedKeywords[symbol] = result;
+    return result;
+}
+
+size_t SymbolTable::size() const {
+    return strings.size();
+}
+
+std::vector<bool> SymbolTable::findContaining(const std::string& needle) const {
+    return scanner.findContaining(needle);
+}
+
+std::vector<std::vector<bool>> SymbolTable::findContainingAll(const std::vector<std::string>& needles) const {
+    return scanner.findContainingAll(needles);
+}
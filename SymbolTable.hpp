@@ -0,0 +1,65 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include "KeywordScanner.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+typedef uint32_t Symbol;
+
+// Interning pool for food identifiers and keywords.
+// Each distinct string is stored once and referred to by a small integer id,
+// so foods sharing keywords ("protein", "fruit") share their storage and
+// keyword comparisons become integer comparisons.
+// Symbols are never removed; strings returned by getString() stay valid.
+//
+// There are two tables with separate symbol numbering: getInstance() holds
+// identifiers, keywords as written and folded identifiers, and
+// getKeywordTable() only the folded keywords that keyword search matches
+// against, so substring scans read no other strings.
+class SymbolTable {
+private:
+    static SymbolTable* instance;
+    static SymbolTable* keywordTable;
+    std::unordered_map<std::string, Symbol> ids;
+    // Points at the keys of ids; unordered_map nodes never move
+    std::vector<const std::string*> strings;
+    // Symbol of each string's folded form (see foldText) in this table and
+    // in the keyword table, filled in on first use; NOT_FOLDED until then
+    std::vector<Symbol> folded;
+    std::vector<Symbol> foldedKeywords;
+    static const Symbol NOT_FOLDED = static_cast<Symbol>(-1);
+    // Only the keyword table packs its strings for substring scans;
+    // index == symbol
+    bool scanned;
+    KeywordScanner scanner;
+    
+    explicit SymbolTable(bool scan);
+    
+public:
+    static SymbolTable* getInstance();
+    static SymbolTable* getKeywordTable();
+    
+    Symbol intern(const std::string& str);
+    bool find(const std::string& str, Symbol& symbol) const;
+    const std::string& getString(Symbol symbol) const;
+    // Symbol of the folded (lowercase, accent-stripped) form of symbol's
+    // string, interning it if needed. Each distinct string is folded once.
+    Symbol getFolded(Symbol symbol);
+    // Same, but the folded form is interned in (and the symbol is of) the
+    // keyword table
+    Symbol getFoldedKeyword(Symbol symbol);
+    size_t size() const;
+    
+    // Marks every symbol whose string contains needle; keyword table only.
+    // Searching the vocabulary once is much cheaper than searching every
+    // food's keywords, and the packed scan is much cheaper than a find()
+    // per string.
+    std::vector<bool> findContaining(const std::string& needle) const;
+    // One mask per needle, all found in a single scan of the vocabulary
+    std::vector<std::vector<bool>> findContainingAll(const std::vector<std::string>& needles) const;
+};
+
+#endif // SYMBOL_TABLE_HPP
@@ -0,0 +1,133 @@
+#include "TaskPool.hpp"
+#include <algorithm>
+
+TaskPool::TaskPool(size_t workerCount) : queued(0), stopping(false) {
+    for (size_t i = 0; i <= workerCount; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::thread(&TaskPool::workerLoop, this, i));
+    }
+}
+
+TaskPool* TaskPool::getInstance() {
+    // Function-local static: safe to call first from any thread
+    static TaskPool* pool = new TaskPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t TaskPool::getThreadCount() const {
+    return queues.size();
+}
+
+bool TaskPool::popOrSteal(size_t home, Task& task) {
+    {
+        Queue& own = *queues[home];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(home + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskPool::run(const Task& task) {
+    (*task.batch->body)(task.index);
+    // Counted down under the lock, so the waiting caller can't return and
+    // destroy the batch while this is still notifying it
+    std::lock_guard<std::mutex> lock(task.batch->mutex);
+    if (--task.batch->remaining == 0) {
+        task.batch->done.notify_all();
+    }
+}
+
+void TaskPool::workerLoop(size_t home) {
+    while (true) {
+        Task task;
+        if (popOrSteal(home, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void TaskPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.remaining = count;
+    // Counted before any task is visible, so a worker popping one can't
+    // decrement first and wrap the counter
+    queued += count;
+    // Neighbouring indices stay on one thread unless they are stolen
+    for (size_t q = 0; q < queues.size(); ++q) {
+        size_t begin = count * q / queues.size();
+        size_t end = count * (q + 1) / queues.size();
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (size_t i = begin; i < end; ++i) {
+            queues[q]->tasks.push_back(Task{&batch, i});
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+
+    // Help out until this batch is finished; tasks from other batches
+    // picked up on the way are run too
+    size_t home = queues.size() - 1;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            if (batch.remaining == 0) {
+                return;
+            }
+        }
+        Task task;
+        if (popOrSteal(home, task)) {
+            run(task);
+        } else {
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            batch.done.wait(lock, [&batch]() { return batch.remaining == 0; });
+            return;
+        }
+    }
+}
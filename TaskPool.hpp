@@ -0,0 +1,63 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Shared work-stealing pool for data-parallel loops.
+// parallelFor() splits its indices into contiguous runs, one per queue.
+// Each thread takes work from the front of its own queue, and when that is
+// empty steals from the back of the others, so uneven work spreads out.
+// The calling thread works through the loop too, which also makes nested
+// parallelFor() calls from inside a task safe.
+class TaskPool {
+private:
+    // One parallelFor() call; remaining is guarded by mutex
+    struct Batch {
+        const std::function<void(size_t)>* body;
+        size_t remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    struct Task {
+        Batch* batch;
+        size_t index;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // One per worker, then one shared by calling threads
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    explicit TaskPool(size_t workerCount);
+    bool popOrSteal(size_t home, Task& task);
+    static void run(const Task& task);
+    void workerLoop(size_t home);
+
+public:
+    // Sized to the hardware concurrency (the caller counts as one thread)
+    static TaskPool* getInstance();
+    ~TaskPool();
+
+    // Threads that run tasks, including the caller
+    size_t getThreadCount() const;
+    // Calls body(i) for every i in [0, count), in parallel, and returns
+    // when all calls have finished. body must not throw.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+};
+
+#endif // TASK_POOL_HPP
@@ -0,0 +1,151 @@
+#include "TextNormalizer.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Base letter of each code point from U+00C0 to U+017F. '*' marks letters
+// that fold to two characters, '.' symbols that are kept as they are.
+const char LATIN_FOLD[] =
+    "aaaaaa*ceeeeiiii"  // U+00C0
+    "dnooooo.ouuuuy**"  // U+00D0
+    "aaaaaa*ceeeeiiii"  // U+00E0
+    "dnooooo.ouuuuy*y"  // U+00F0
+    "aaaaaaccccccccdd"  // U+0100
+    "ddeeeeeeeeeegggg"  // U+0110
+    "gggghhhhiiiiiiii"  // U+0120
+    "ii**jjkkklllllll"  // U+0130
+    "lllnnnnnnnnnoooo"  // U+0140
+    "oo**rrrrrrssssss"  // U+0150
+    "ssttttttuuuuuuuu"  // U+0160
+    "uuuuwwyyyzzzzzzs"; // U+0170
+
+const char* foldLigature(uint32_t codePoint) {
+    switch (codePoint) {
+        case 0x00C6: case 0x00E6: return "ae";
+        case 0x00DE: case 0x00FE: return "th";
+        case 0x00DF: return "ss";
+        case 0x0132: case 0x0133: return "ij";
+        case 0x0152: case 0x0153: return "oe";
+        default: return nullptr;
+    }
+}
+
+void appendUtf8(uint32_t codePoint, std::string& out) {
+    if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+    } else {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    }
+    out += static_cast<char>(0x80 | (codePoint & 0x3F));
+}
+
+// Decodes the sequence starting at text[i]; returns its length, or 0 if
+// it isn't well-formed UTF-8
+size_t decodeUtf8(const std::string& text, size_t i, uint32_t& codePoint) {
+    unsigned char lead = static_cast<unsigned char>(text[i]);
+    size_t length;
+    uint32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        length = 2; minimum = 0x80; codePoint = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3; minimum = 0x800; codePoint = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4; minimum = 0x10000; codePoint = lead & 0x07;
+    } else {
+        return 0;
+    }
+    if (i + length > text.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < length; ++k) {
+        unsigned char next = static_cast<unsigned char>(text[i + k]);
+        if ((next & 0xC0) != 0x80) {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+    return codePoint >= minimum && codePoint <= 0x10FFFF ? length : 0;
+}
+
+// Folds one non-ASCII code point, whose original bytes are text[i, i + length)
+void foldCodePoint(uint32_t codePoint, const std::string& text, size_t i, size_t length, std::string& out) {
+    if (codePoint >= 0x00C0 && codePoint <= 0x017F) {
+        char base = LATIN_FOLD[codePoint - 0x00C0];
+        if (base == '*') {
+            out += foldLigature(codePoint);
+            return;
+        }
+        if (base != '.') {
+            out += base;
+            return;
+        }
+    } else if (codePoint >= 0x0300 && codePoint <= 0x036F) {
+        return; // Combining accent of a decomposed letter
+    } else if ((codePoint >= 0x0391 && codePoint <= 0x03A9 && codePoint != 0x03A2) ||
+               (codePoint >= 0x0410 && codePoint <= 0x042F)) {
+        appendUtf8(codePoint + 0x20, out);
+        return;
+    } else if (codePoint >= 0x0400 && codePoint <= 0x040F) {
+        appendUtf8(codePoint + 0x50, out);
+        return;
+    }
+    out.append(text, i, length);
+}
+
+// Length of the leading run of ASCII bytes, checked eight at a time
+size_t asciiPrefixLength(const std::string& text) {
+    const char* data = text.data();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+    while (i < text.size() && static_cast<unsigned char>(data[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+inline char lowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+} // namespace
+
+void foldTextInto(const std::string& text, std::string& out) {
+    size_t ascii = asciiPrefixLength(text);
+    out.reserve(out.size() + text.size());
+    for (size_t i = 0; i < ascii; ++i) {
+        out += lowerAscii(text[i]);
+    }
+
+    size_t i = ascii;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            out += lowerAscii(text[i]);
+            ++i;
+            continue;
+        }
+        uint32_t codePoint;
+        size_t length = decodeUtf8(text, i, codePoint);
+        if (length == 0) {
+            out += text[i]; // Not UTF-8; keep the byte
+            ++i;
+            continue;
+        }
+        foldCodePoint(codePoint, text, i, length, out);
+        i += length;
+    }
+}
+
+std::string foldText(const std::string& text) {
+    std::string folded;
+    foldTextInto(text, folded);
+    return folded;
+}
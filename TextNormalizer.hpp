@@ -0,0 +1,16 @@
+#ifndef TEXT_NORMALIZER_HPP
+#define TEXT_NORMALIZER_HPP
+
+#include <string>
+
+// Folds text to the form used for keyword matching: lowercase, with the
+// accents of Latin letters stripped ("Crème Brûlée" -> "creme brulee",
+// "Straße" -> "strasse"). Greek and Cyrillic capitals are lowercased and
+// combining marks dropped; other characters, and bytes that aren't valid
+// UTF-8, are kept as they are. Pure ASCII input takes a fast path.
+std::string foldText(const std::string& text);
+
+// Appends the folded form of text to out
+void foldTextInto(const std::string& text, std::string& out);
+
+#endif // TEXT_NORMALIZER_HPP
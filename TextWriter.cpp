@@ -0,0 +1,96 @@
+#include "TextWriter.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+TextWriter::TextWriter(std::ostream* out, size_t threshold) : sink(out), flushThreshold(threshold) {
+    buffer.reserve(sink ? threshold + 256 : 256);
+}
+
+TextWriter::~TextWriter() {
+    flush();
+}
+
+void TextWriter::maybeFlush() {
+    if (sink && buffer.size() >= flushThreshold) {
+        flush();
+    }
+}
+
+TextWriter& TextWriter::write(const char* data, size_t size) {
+    buffer.append(data, size);
+    maybeFlush();
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(const std::string& text) {
+    return write(text.data(), text.size());
+}
+
+TextWriter& TextWriter::operator<<(const char* text) {
+    return write(text, std::strlen(text));
+}
+
+TextWriter& TextWriter::operator<<(char c) {
+    buffer.push_back(c);
+    maybeFlush();
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(int value) {
+    return *this << static_cast<long long>(value);
+}
+
+TextWriter& TextWriter::operator<<(long long value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value)
+                                             : static_cast<unsigned long long>(value);
+    do {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    return write(p, end - p);
+}
+
+TextWriter& TextWriter::operator<<(size_t value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return write(p, end - p);
+}
+
+TextWriter& TextWriter::operator<<(double value) {
+    // Whole numbers below 1e6 print the same under "%g" as plain integers,
+    // which covers most calorie and serving values
+    if (value > -1e6 && value < 1e6 && value == std::floor(value) && !(value == 0 && std::signbit(value))) {
+        return *this << static_cast<long long>(value);
+    }
+    
+    char text[32];
+    int size = std::snprintf(text, sizeof(text), "%g", value);
+    return write(text, size);
+}
+
+void TextWriter::flush() {
+    if (sink && !buffer.empty()) {
+        sink->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+const std::string& TextWriter::str() const {
+    return buffer;
+}
+
+void TextWriter::clear() {
+    buffer.clear();
+}
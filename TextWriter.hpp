@@ -0,0 +1,41 @@
+#ifndef TEXT_WRITER_HPP
+#define TEXT_WRITER_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+// Appends text to a reusable buffer instead of building a std::stringstream
+// per object. With a sink the buffer is written out in large chunks (and on
+// flush/destruction); without one it simply accumulates, see str().
+// Doubles are formatted like the default std::ostream formatting ("%g").
+class TextWriter {
+private:
+    std::string buffer;
+    std::ostream* sink;
+    size_t flushThreshold;
+    
+    void maybeFlush();
+    
+public:
+    explicit TextWriter(std::ostream* out = nullptr, size_t threshold = 64 * 1024);
+    ~TextWriter();
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+    
+    TextWriter& write(const char* data, size_t size);
+    TextWriter& operator<<(const std::string& text);
+    TextWriter& operator<<(const char* text);
+    TextWriter& operator<<(char c);
+    TextWriter& operator<<(int value);
+    TextWriter& operator<<(long long value);
+    TextWriter& operator<<(size_t value);
+    TextWriter& operator<<(double value);
+    
+    // Writes the buffered text to the sink (no-op without one)
+    void flush();
+    const std::string& str() const;
+    void clear();
+};
+
+#endif // TEXT_WRITER_HPP
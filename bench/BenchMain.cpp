@@ -0,0 +1,530 @@
+// yada_bench: reproducible microbenchmarks over synthetic data.
+//
+// Usage: yada_bench [--foods N] [--depth D] [--years Y] [--users U]
+//                   [--terms T] [--seed S] [--iterations I] [--dir PATH] [--out FILE]
+//
+// --terms sets the size of the random dictionary used to compare the
+// fuzzy index against a brute-force edit distance scan, and the prefix
+// trie against binary searches over the same sorted terms. The same
+// dictionary is used for the packed substring scan kernels.
+//
+// Results are written as JSON (to --out, or stdout) so runs can be compared
+// across releases.
+#include "SyntheticData.hpp"
+#include "FoodDatabase.hpp"
+#include "DailyLog.hpp"
+#include "DietProfile.hpp"
+#include "FoodTracker.hpp"
+#include "ReportEngine.hpp"
+#include "FuzzyIndex.hpp"
+#include "PrefixIndex.hpp"
+#include "TextNormalizer.hpp"
+#include "KeywordScanner.hpp"
+#include "TaskPool.hpp"
+#include "FoodImporter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+    
+    struct BenchResult {
+        std::string name;
+        size_t iterations;
+        size_t opsPerIteration;
+        double minNs;
+        double medianNs;
+        double meanNs;
+        double maxNs;
+    };
+    
+    // Runs fn `iterations` times; each run performs opsPerIteration operations
+    BenchResult runBenchmark(const std::string& name, size_t iterations, size_t opsPerIteration,
+                             const std::function<void()>& fn) {
+        std::vector<double> samples;
+        for (size_t i = 0; i < iterations; ++i) {
+            Clock::time_point start = Clock::now();
+            fn();
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            samples.push_back(ns / opsPerIteration);
+        }
+        std::sort(samples.begin(), samples.end());
+        
+        BenchResult result;
+        result.name = name;
+        result.iterations = iterations;
+        result.opsPerIteration = opsPerIteration;
+        result.minNs = samples.front();
+        result.maxNs = samples.back();
+        result.medianNs = samples[samples.size() / 2];
+        double sum = 0.0;
+        for (double sample : samples) sum += sample;
+        result.meanNs = sum / samples.size();
+        
+        std::cerr << name << ": median " << result.medianNs << " ns/op\n";
+        return result;
+    }
+    
+    void writeJson(std::ostream& out, const SyntheticConfig& config, size_t iterations,
+                   const std::vector<BenchResult>& results) {
+        out << "{\n";
+        out << "  \"config\": {\"foods\": " << config.foods << ", \"composite_depth\": " << config.compositeDepth
+            << ", \"years\": " << config.years << ", \"users\": " << config.users
+            << ", \"seed\": " << config.seed << ", \"iterations\": " << iterations << "},\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                << ", \"ops_per_iteration\": " << r.opsPerIteration
+                << ", \"min_ns\": " << r.minNs << ", \"median_ns\": " << r.medianNs
+                << ", \"mean_ns\": " << r.meanNs << ", \"max_ns\": " << r.maxNs << "}";
+            out << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+    
+    // Discards everything written to it; used to silence console summaries
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+}
+
+int main(int argc, char* argv[]) {
+    SyntheticConfig config = {10000, 3, 2, 4, 42};
+    size_t iterations = 10;
+    size_t termCount = 100000;
+    std::string dir = ".";
+    std::string outFile;
+    
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+        if (option == "--foods") config.foods = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--depth") config.compositeDepth = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--years") config.years = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--users") config.users = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--seed") config.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (option == "--iterations") iterations = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--terms") termCount = std::strtoul(value.c_str(), nullptr, 10);
+        else if (option == "--dir") dir = value;
+        else if (option == "--out") outFile = value;
+        else {
+            std::cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+    if (config.foods == 0 || config.users == 0 || config.years == 0 || iterations == 0) {
+        std::cerr << "--foods, --users, --years and --iterations must be positive\n";
+        return 1;
+    }
+    
+    // Generate input files
+    SyntheticData data(config);
+    std::string foodsFile = dir + "/yada_bench_foods.txt";
+    if (!data.writeFoods(foodsFile)) {
+        std::cerr << "Could not write " << foodsFile << "\n";
+        return 1;
+    }
+    std::vector<std::string> logFiles, profileFiles;
+    for (size_t u = 0; u < config.users; ++u) {
+        logFiles.push_back(dir + "/yada_bench_log" + std::to_string(u) + ".txt");
+        profileFiles.push_back(dir + "/yada_bench_profile" + std::to_string(u) + ".txt");
+        data.writeLog(logFiles.back(), u);
+        data.writeProfile(profileFiles.back(), u);
+    }
+    std::vector<std::string> dates = data.getDates();
+    
+    // Keep library console messages out of the measurements
+    NullBuffer nullBuffer;
+    std::streambuf* consoleBuffer = std::cout.rdbuf(&nullBuffer);
+    
+    std::vector<BenchResult> results;
+    FoodDatabase* db = FoodDatabase::getInstance();
+    db->setDatabaseFile(foodsFile);
+    
+    results.push_back(runBenchmark("FoodDatabase::loadDatabase", iterations, 1, [&]() {
+        db->loadDatabase();
+    }));
+    
+    // Queries of one and two vocabulary words
+    std::mt19937 rng(config.seed);
+    const auto& vocabulary = data.getVocabulary();
+    std::vector<std::vector<std::string>> queries;
+    for (size_t i = 0; i < 64; ++i) {
+        std::vector<std::string> query(1, vocabulary[rng() % vocabulary.size()]);
+        if (i % 2 == 1) query.push_back(vocabulary[rng() % vocabulary.size()]);
+        queries.push_back(query);
+    }
+    
+    size_t matches = 0;
+    for (int matchAll = 1; matchAll >= 0; --matchAll) {
+        std::string mode = matchAll ? "all" : "any";
+        results.push_back(runBenchmark("FoodDatabase::findFoods/" + mode + "/uncached", iterations, queries.size(), [&]() {
+            for (const auto& query : queries) {
+                db->clearSearchCache();
+                matches += db->findFoods(query, matchAll != 0).size();
+            }
+        }));
+        results.push_back(runBenchmark("FoodDatabase::findFoods/" + mode + "/cached", iterations, queries.size(), [&]() {
+            for (const auto& query : queries) {
+                matches += db->findFoods(query, matchAll != 0).size();
+            }
+        }));
+        results.push_back(runBenchmark("FoodDatabase::viewFoods/" + mode + "/cached", iterations, queries.size(), [&]() {
+            for (const auto& query : queries) {
+                matches += db->viewFoods(query, matchAll != 0).size();
+            }
+        }));
+    }
+    
+    // Sharded matching on the task pool against one thread, whatever the
+    // database size; run with --foods 10000000 for a large catalog
+    std::string threads = std::to_string(TaskPool::getInstance()->getThreadCount());
+    size_t defaultThreshold = db->getParallelSearchThreshold();
+    for (int matchAll = 1; matchAll >= 0; --matchAll) {
+        std::string mode = matchAll ? "all" : "any";
+        size_t sequentialMatches = 0, parallelMatches = 0;
+        db->setParallelSearchThreshold(static_cast<size_t>(-1));
+        results.push_back(runBenchmark("FoodDatabase::findFoods/" + mode + "/sequential", iterations, queries.size(), [&]() {
+            for (const auto& query : queries) {
+                db->clearSearchCache();
+                sequentialMatches += db->findFoods(query, matchAll != 0).size();
+            }
+        }));
+        db->setParallelSearchThreshold(0);
+        results.push_back(runBenchmark("FoodDatabase::findFoods/" + mode + "/parallel-" + threads, iterations, queries.size(), [&]() {
+            for (const auto& query : queries) {
+                db->clearSearchCache();
+                parallelMatches += db->findFoods(query, matchAll != 0).size();
+            }
+        }));
+        db->clearSearchCache();
+        std::vector<const Food*> parallelOrder = db->findFoods(queries[0], matchAll != 0);
+        db->setParallelSearchThreshold(static_cast<size_t>(-1));
+        db->clearSearchCache();
+        if (sequentialMatches != parallelMatches || parallelOrder != db->findFoods(queries[0], matchAll != 0)) {
+            std::cerr << "Parallel findFoods found " << parallelMatches << " foods, sequential " << sequentialMatches << "\n";
+            return 1;
+        }
+    }
+    db->setParallelSearchThreshold(defaultThreshold);
+    
+    // Vocabulary words with one character replaced
+    std::vector<std::string> typos;
+    for (const auto& query : queries) {
+        std::string typo = query[0];
+        typo[rng() % typo.size()] = static_cast<char>('a' + rng() % 26);
+        typos.push_back(typo);
+    }
+    size_t fuzzyMatches = 0;
+    results.push_back(runBenchmark("FoodDatabase::fuzzySearch/any", iterations, typos.size(), [&]() {
+        for (const auto& typo : typos) {
+            fuzzyMatches += db->fuzzySearch(std::vector<std::string>(1, typo), false, 10).results.size();
+        }
+    }));
+    
+    // Folding capitalized vocabulary words, then the same words with an accent
+    std::vector<std::string> asciiWords, accentedWords;
+    for (const auto& query : queries) {
+        std::string word = query[0];
+        word[0] = static_cast<char>(word[0] - 'a' + 'A');
+        asciiWords.push_back(word);
+        accentedWords.push_back(word + "\xC3\xA9"); // e acute
+    }
+    size_t foldedBytes = 0;
+    results.push_back(runBenchmark("foldText/ascii", iterations, asciiWords.size(), [&]() {
+        for (const auto& word : asciiWords) foldedBytes += foldText(word).size();
+    }));
+    results.push_back(runBenchmark("foldText/utf8", iterations, accentedWords.size(), [&]() {
+        for (const auto& word : accentedWords) foldedBytes += foldText(word).size();
+    }));
+    
+    // Typed prefixes of vocabulary words, as the menus see them
+    size_t completions = 0;
+    results.push_back(runBenchmark("FoodDatabase::autocomplete", iterations, queries.size(), [&]() {
+        for (const auto& query : queries) {
+            completions += db->autocomplete(query[0].substr(0, 1 + query[0].size() / 2), 10).size();
+        }
+    }));
+    
+    // Deepest composites are the most expensive to evaluate
+    std::vector<const Food*> composites;
+    for (const Food* food : db->viewAllFoods()) {
+        if (food->getKind() == FoodKind::Composite) composites.push_back(food);
+    }
+    double calorieSum = 0.0;
+    if (!composites.empty()) {
+        results.push_back(runBenchmark("CompositeFood::getCaloriesPerServing", iterations, composites.size(), [&]() {
+            for (const Food* food : composites) {
+                calorieSum += food->getCaloriesPerServing();
+            }
+        }));
+    }
+    
+    // Lookups in a published snapshot against the live map, then publishing
+    // new versions of the basic food with the most composites using it
+    std::vector<const Food*> liveFoods = db->getAllFoods();
+    std::vector<std::string> lookupIds;
+    for (size_t i = 0; i < 1024 && !liveFoods.empty(); ++i) {
+        lookupIds.push_back(liveFoods[rng() % liveFoods.size()]->getIdentifier());
+    }
+    size_t lookupHits = 0;
+    results.push_back(runBenchmark("FoodDatabase::getFood", iterations, lookupIds.size(), [&]() {
+        for (const auto& id : lookupIds) {
+            lookupHits += db->getFood(id) != nullptr;
+        }
+    }));
+    FoodMap snapshot = db->getSnapshot();
+    results.push_back(runBenchmark("FoodMap::find", iterations, lookupIds.size(), [&]() {
+        for (const auto& id : lookupIds) {
+            lookupHits += snapshot.find(id) != nullptr;
+        }
+    }));
+    for (const auto& id : lookupIds) {
+        if (snapshot.find(id) != db->getFood(id)) {
+            std::cerr << "Snapshot disagrees with the database on " << id << "\n";
+            return 1;
+        }
+    }
+    const Food* edited = nullptr;
+    size_t editedUsers = 0;
+    for (const Food* food : liveFoods) {
+        size_t users = db->getDependents(food).size();
+        if (food->getKind() == FoodKind::Basic && (!edited || users > editedUsers)) {
+            edited = food;
+            editedUsers = users;
+        }
+    }
+    if (edited) {
+        std::string editedId = edited->getIdentifier();
+        results.push_back(runBenchmark("FoodDatabase::updateFood", iterations, 1, [&]() {
+            const Food* current = db->getFood(editedId);
+            NutrientVector nutrients = current->getNutrientsPerServing();
+            nutrients.set(Nutrient::Calories, nutrients.get(Nutrient::Calories) + 1.0);
+            db->updateFood(db->createBasicFood(editedId, current->getKeywords(), nutrients));
+        }));
+        if (snapshot.find(editedId) != edited || db->getSnapshot().find(editedId) != db->getFood(editedId)) {
+            std::cerr << "Snapshot changed by a later update\n";
+            return 1;
+        }
+    }
+    
+    std::vector<DailyLog> logs(config.users);
+    for (size_t u = 0; u < config.users; ++u) {
+        logs[u].setLogFile(logFiles[u]);
+    }
+    results.push_back(runBenchmark("DailyLog::loadLog", iterations, config.users, [&]() {
+        for (auto& log : logs) log.loadLog();
+    }));
+    results.push_back(runBenchmark("DailyLog::loadLog+loadRange", iterations, config.users, [&]() {
+        for (auto& log : logs) {
+            log.loadLog();
+            log.loadRange(dates.front(), dates.back());
+        }
+    }));
+    results.push_back(runBenchmark("DailyLog::saveLog", iterations, config.users, [&]() {
+        for (auto& log : logs) log.saveLog();
+    }));
+    size_t dateCount = 0;
+    results.push_back(runBenchmark("DailyLog::getAllDates", iterations, config.users, [&]() {
+        for (auto& log : logs) dateCount += log.getAllDates().size();
+    }));
+    results.push_back(runBenchmark("DailyLog::forEachDate", iterations, config.users, [&]() {
+        for (auto& log : logs) log.forEachDate([&dateCount](const std::string&) { ++dateCount; });
+    }));
+    
+    std::vector<DietProfile> profiles(config.users);
+    for (size_t u = 0; u < config.users; ++u) {
+        profiles[u].setProfileFile(profileFiles[u]);
+        profiles[u].loadProfile();
+    }
+    std::vector<std::string> queryDates;
+    for (size_t i = 0; i < 1000; ++i) {
+        queryDates.push_back(dates[rng() % dates.size()]);
+    }
+    double weightSum = 0.0;
+    results.push_back(runBenchmark("DietProfile::getWeight", iterations, queryDates.size() * config.users, [&]() {
+        for (const auto& profile : profiles) {
+            for (const auto& date : queryDates) weightSum += profile.getWeight(date);
+        }
+    }));
+    
+    results.push_back(runBenchmark("FoodTracker::displayDailySummary", iterations, queryDates.size(), [&]() {
+        FoodTracker tracker(logs[0], profiles[0]);
+        for (const auto& date : queryDates) {
+            logs[0].setCurrentDate(date); // notifies the tracker, which prints a summary
+        }
+    }));
+    
+    // Index walk against a brute-force scan over a random dictionary
+    std::vector<std::string> terms;
+    for (size_t i = 0; i < termCount; ++i) {
+        std::string term(4 + rng() % 9, 'a');
+        for (char& c : term) c = static_cast<char>('a' + rng() % 26);
+        terms.push_back(term);
+    }
+    FuzzyIndex index;
+    index.assign(terms);
+    std::vector<std::string> termQueries;
+    for (size_t i = 0; i < 100; ++i) {
+        std::string query = terms[rng() % terms.size()];
+        query[rng() % query.size()] = static_cast<char>('a' + rng() % 26);
+        termQueries.push_back(query);
+    }
+    size_t indexMatches = 0, scanMatches = 0;
+    std::vector<std::pair<uint32_t, size_t>> found;
+    results.push_back(runBenchmark("FuzzyIndex::findWithin/radius2", iterations, termQueries.size(), [&]() {
+        for (const auto& query : termQueries) {
+            found.clear();
+            index.findWithin(query, 2, found);
+            indexMatches += found.size();
+        }
+    }));
+    results.push_back(runBenchmark("BruteForceEditDistance/radius2", iterations, termQueries.size(), [&]() {
+        for (const auto& query : termQueries) {
+            for (size_t t = 0; t < index.size(); ++t) {
+                if (FuzzyIndex::editDistance(query, index.getTerm(static_cast<uint32_t>(t))) <= 2) ++scanMatches;
+            }
+        }
+    }));
+    if (indexMatches != scanMatches) {
+        std::cerr << "FuzzyIndex found " << indexMatches << " matches, brute force " << scanMatches << "\n";
+        return 1;
+    }
+    
+    // Trie lookup against two binary searches over the sorted dictionary
+    std::vector<std::string> sortedTerms;
+    for (size_t t = 0; t < index.size(); ++t) sortedTerms.push_back(index.getTerm(static_cast<uint32_t>(t)));
+    PrefixIndex prefixIndex;
+    prefixIndex.build(sortedTerms);
+    std::vector<std::string> prefixQueries;
+    for (const auto& query : termQueries) prefixQueries.push_back(query.substr(0, 3));
+    size_t trieRange = 0, searchRange = 0;
+    results.push_back(runBenchmark("PrefixIndex::findRange", iterations, prefixQueries.size(), [&]() {
+        for (const auto& prefix : prefixQueries) {
+            size_t begin, end;
+            if (prefixIndex.findRange(prefix, begin, end)) trieRange += end - begin;
+        }
+    }));
+    results.push_back(runBenchmark("BinarySearchPrefixRange", iterations, prefixQueries.size(), [&]() {
+        for (const auto& prefix : prefixQueries) {
+            auto first = std::lower_bound(sortedTerms.begin(), sortedTerms.end(), prefix);
+            auto last = std::partition_point(first, sortedTerms.end(), [&prefix](const std::string& term) {
+                return term.compare(0, prefix.size(), prefix) == 0;
+            });
+            searchRange += last - first;
+        }
+    }));
+    if (trieRange != searchRange) {
+        std::cerr << "PrefixIndex covered " << trieRange << " terms, binary search " << searchRange << "\n";
+        return 1;
+    }
+    
+    // Substring scan: find() per term against each supported packed kernel.
+    // Half the needles are absent, which is the worst case for both.
+    KeywordScanner scanner;
+    for (const auto& term : terms) scanner.append(term);
+    std::vector<std::string> needles;
+    for (size_t i = 0; i < 8; ++i) {
+        const std::string& term = terms[rng() % terms.size()];
+        needles.push_back(i % 2 ? term.substr(0, 4) : term.substr(0, 3) + "qq");
+    }
+    size_t findHits = 0;
+    results.push_back(runBenchmark("SubstringScan/string::find", iterations, needles.size(), [&]() {
+        for (const auto& needle : needles) {
+            for (const auto& term : terms) {
+                if (term.find(needle) != std::string::npos) ++findHits;
+            }
+        }
+    }));
+    const ScanKernel kernels[] = {ScanKernel::Scalar, ScanKernel::Sse2, ScanKernel::Avx2};
+    for (ScanKernel kernel : kernels) {
+        if (!scanner.setKernel(kernel)) continue;
+        size_t scanHits = 0;
+        results.push_back(runBenchmark(std::string("KeywordScanner::findContaining/") + KeywordScanner::getKernelName(kernel),
+                                       iterations, needles.size(), [&]() {
+            for (const auto& needle : needles) {
+                std::vector<bool> mask = scanner.findContaining(needle);
+                scanHits += std::count(mask.begin(), mask.end(), true);
+            }
+        }));
+        if (scanHits != findHits) {
+            std::cerr << "KeywordScanner (" << KeywordScanner::getKernelName(kernel) << ") found " << scanHits
+                      << " terms, string::find " << findHits << "\n";
+            return 1;
+        }
+        
+        // All needles in one pass, as findFoods resolves its keywords
+        size_t allHits = 0;
+        results.push_back(runBenchmark(std::string("KeywordScanner::findContainingAll/") + KeywordScanner::getKernelName(kernel),
+                                       iterations, needles.size(), [&]() {
+            for (const auto& mask : scanner.findContainingAll(needles)) {
+                allHits += std::count(mask.begin(), mask.end(), true);
+            }
+        }));
+        if (allHits != findHits) {
+            std::cerr << "KeywordScanner::findContainingAll (" << KeywordScanner::getKernelName(kernel) << ") found "
+                      << allHits << " terms, string::find " << findHits << "\n";
+            return 1;
+        }
+    }
+    
+    double reportSum = 0.0;
+    results.push_back(runBenchmark("ReportEngine::build/1-thread", iterations, config.users, [&]() {
+        for (size_t u = 0; u < config.users; ++u) {
+            reportSum += ReportEngine(logs[u], profiles[u], 1).build().projectedWeight90;
+        }
+    }));
+    results.push_back(runBenchmark("ReportEngine::build/parallel", iterations, config.users, [&]() {
+        for (size_t u = 0; u < config.users; ++u) {
+            reportSum += ReportEngine(logs[u], profiles[u]).build().projectedWeight90;
+        }
+    }));
+    
+    // Bulk import of a CSV with one new food per synthetic food; each
+    // iteration uses its own identifiers so every row is inserted
+    std::vector<std::string> importFiles;
+    for (size_t i = 0; i < iterations; ++i) {
+        std::ostringstream csv;
+        csv << "name,category,energy (kcal),protein,total fat,sodium\n";
+        for (size_t f = 0; f < config.foods; ++f) {
+            csv << "\"Imported " << i << ", item " << f << "\",group" << f % 50 << "," << 50 + rng() % 800 << ","
+                << rng() % 40 << "." << rng() % 10 << "," << rng() % 30 << "," << rng() % 900 << "\n";
+        }
+        importFiles.push_back(csv.str());
+    }
+    size_t importIteration = 0, importedRows = 0;
+    results.push_back(runBenchmark("FoodImporter::importStream", iterations, config.foods, [&]() {
+        std::istringstream in(importFiles[importIteration++]);
+        FoodImporter importer(db);
+        ImportProgress progress;
+        importer.importStream(in, 0, progress);
+        importedRows += progress.imported;
+    }));
+    if (importedRows != iterations * config.foods) {
+        std::cerr << "FoodImporter imported " << importedRows << " of " << iterations * config.foods << " rows\n";
+        return 1;
+    }
+    
+    std::cout.rdbuf(consoleBuffer);
+    std::cerr << "(checksums " << matches << " " << fuzzyMatches << " " << completions << " " << foldedBytes << " " << calorieSum << " " << lookupHits << " " << dateCount << " " << weightSum << " " << reportSum << ")\n";
+    
+    if (outFile.empty()) {
+        writeJson(std::cout, config, iterations, results);
+    } else {
+        std::ofstream out(outFile);
+        writeJson(out, config, iterations, results);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Compares the virtual Food interface with the tag-dispatched hot paths
+// on synthetic data: daily calorie totals, nutrient totals and saving.
+#include "FoodDatabase.hpp"
+#include "DailyLog.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+    
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    
+    void report(const std::string& name, double virtualMs, double taggedMs, double check) {
+        std::cout << name << ": virtual " << virtualMs << " ms, tagged " << taggedMs
+                  << " ms, speedup " << (taggedMs > 0 ? virtualMs / taggedMs : 0.0)
+                  << " (checksum " << check << ")\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t foodCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    size_t dayCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3650;
+    const size_t entriesPerDay = 8;
+    
+    // Half basic foods, half composites built from earlier foods
+    FoodDatabase* db = FoodDatabase::getInstance();
+    std::vector<const Food*> foods;
+    for (size_t i = 0; i < foodCount; ++i) {
+        std::string id = "food" + std::to_string(i);
+        std::vector<std::string> keys = {"k" + std::to_string(i % 97), "k" + std::to_string(i % 13)};
+        const Food* food;
+        if (i < 16 || i % 2 == 0) {
+            NutrientVector n;
+            n.set(Nutrient::Calories, 50 + i % 400);
+            n.set(Nutrient::Protein, i % 30);
+            food = db->createBasicFood(id, keys, n);
+        } else {
+            std::vector<FoodComponent> comps;
+            for (size_t c = 1; c <= 3; ++c) {
+                comps.push_back(FoodComponent(foods[(i * 7 + c * 31) % i], 0.5 * c));
+            }
+            food = db->createCompositeFood(id, keys, comps);
+        }
+        db->addFood(food);
+        foods.push_back(food);
+    }
+    
+    std::vector<DayLog> days(dayCount);
+    for (size_t d = 0; d < dayCount; ++d) {
+        for (size_t e = 0; e < entriesPerDay; ++e) {
+            days[d].addEntry(LogEntry(foods[(d * 131 + e * 17) % foods.size()], 1.0 + e % 3));
+        }
+    }
+    
+    // Daily calorie totals
+    Clock::time_point start = Clock::now();
+    double virtualTotal = 0.0;
+    for (const auto& day : days) {
+        for (const auto& entry : day.getEntries()) {
+            virtualTotal += entry.food->getCaloriesPerServing() * entry.servings;
+        }
+    }
+    double virtualMs = elapsedMs(start);
+    
+    start = Clock::now();
+    double taggedTotal = 0.0;
+    for (const auto& day : days) {
+        taggedTotal += day.getTotalCalories();
+    }
+    report("daily calorie totals", virtualMs, elapsedMs(start), taggedTotal - virtualTotal);
+    
+    // Daily nutrient totals
+    start = Clock::now();
+    NutrientVector virtualNutrients;
+    for (const auto& day : days) {
+        for (const auto& entry : day.getEntries()) {
+            entry.food->accumulateNutrients(virtualNutrients, entry.servings);
+        }
+    }
+    virtualMs = elapsedMs(start);
+    
+    start = Clock::now();
+    NutrientVector taggedNutrients;
+    for (const auto& day : days) {
+        taggedNutrients += day.getTotalNutrients();
+    }
+    report("daily nutrient totals", virtualMs, elapsedMs(start),
+           taggedNutrients.get(Nutrient::Protein) - virtualNutrients.get(Nutrient::Protein));
+    
+    // Serialization of the whole database
+    start = Clock::now();
+    std::ostringstream virtualOut;
+    for (const Food* food : foods) {
+        virtualOut << food->serialize() << "\n";
+    }
+    virtualMs = elapsedMs(start);
+    
+    start = Clock::now();
+    TextWriter taggedOut;
+    for (const Food* food : foods) {
+        food->serializeTo(taggedOut);
+        taggedOut << '\n';
+    }
+    report("serialize database", virtualMs, elapsedMs(start),
+           static_cast<double>(taggedOut.str().size()) - virtualOut.str().size());
+    
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "SyntheticData.hpp"
+#include "TextWriter.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace {
+    const char* const BASE_WORDS[] = {
+        "fruit", "vegetable", "protein", "dairy", "grain", "fresh", "sweet", "salad",
+        "meat", "fish", "breakfast", "lunch", "dinner", "snack", "spread", "drink",
+        "healthy", "fried", "baked", "raw", "organic", "spicy", "italian", "green"
+    };
+    
+    // Days in month, ignoring leap years beyond the simple rule
+    int daysInMonth(int year, int month) {
+        static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) return 29;
+        return days[month - 1];
+    }
+}
+
+SyntheticData::SyntheticData(const SyntheticConfig& c) : config(c) {
+    for (const char* word : BASE_WORDS) {
+        vocabulary.push_back(word);
+    }
+    // Add rarer words so the vocabulary grows with the catalog
+    for (size_t i = 0; i < config.foods / 50; ++i) {
+        vocabulary.push_back("term" + std::to_string(i));
+    }
+}
+
+const SyntheticConfig& SyntheticData::getConfig() const { return config; }
+const std::vector<std::string>& SyntheticData::getFoodIds() const { return foodIds; }
+const std::vector<std::string>& SyntheticData::getVocabulary() const { return vocabulary; }
+
+std::vector<std::string> SyntheticData::getDates() const {
+    std::vector<std::string> dates;
+    for (size_t y = 0; y < config.years; ++y) {
+        int year = 2000 + static_cast<int>(y);
+        for (int month = 1; month <= 12; ++month) {
+            for (int day = 1; day <= daysInMonth(year, month); ++day) {
+                char date[36]; // Room for any three ints, so -Wformat-truncation stays quiet
+                std::snprintf(date, sizeof(date), "%04d-%02d-%02d", year, month, day);
+                dates.push_back(date);
+            }
+        }
+    }
+    return dates;
+}
+
+bool SyntheticData::writeFoods(const std::string& file) {
+    std::ofstream out(file);
+    if (!out.is_open()) {
+        return false;
+    }
+    
+    std::mt19937 rng(config.seed);
+    std::uniform_int_distribution<size_t> wordDist(0, vocabulary.size() - 1);
+    std::uniform_int_distribution<int> calorieDist(5, 600);
+    
+    // 70% basic foods; the rest are spread evenly over composite levels
+    // 1..depth, each level built from foods of the level below
+    size_t basicCount = config.compositeDepth == 0 ? config.foods : std::max<size_t>(1, config.foods * 7 / 10);
+    size_t perLevel = config.compositeDepth == 0 ? 0 : (config.foods - basicCount) / config.compositeDepth;
+    
+    foodIds.clear();
+    std::vector<size_t> levelStart(1, 0);
+    TextWriter writer(&out);
+    for (size_t i = 0; i < config.foods; ++i) {
+        size_t level = i < basicCount ? 0 : std::min(config.compositeDepth, 1 + (i - basicCount) / std::max<size_t>(1, perLevel));
+        if (level >= levelStart.size()) {
+            levelStart.push_back(i);
+        }
+        
+        std::string id = (level == 0 ? "Food" : "Dish") + std::to_string(i);
+        writer << (level == 0 ? "BASIC;" : "COMPOSITE;") << id << ";";
+        size_t keywordCount = 2 + rng() % 3;
+        for (size_t k = 0; k < keywordCount; ++k) {
+            if (k > 0) writer << ",";
+            writer << vocabulary[wordDist(rng)];
+        }
+        writer << ";";
+        
+        if (level == 0) {
+            writer << calorieDist(rng) << ";protein=" << static_cast<int>(rng() % 40)
+                   << ",fat=" << static_cast<int>(rng() % 30) << ",carbohydrates=" << static_cast<int>(rng() % 60);
+        } else {
+            size_t from = levelStart[level - 1];
+            size_t to = levelStart[level];
+            size_t componentCount = 2 + rng() % 3;
+            for (size_t c = 0; c < componentCount; ++c) {
+                if (c > 0) writer << ",";
+                writer << foodIds[from + rng() % (to - from)] << ":" << static_cast<int>(1 + rng() % 3);
+            }
+        }
+        writer << '\n';
+        foodIds.push_back(id);
+    }
+    writer.flush();
+    return true;
+}
+
+bool SyntheticData::writeLog(const std::string& file, size_t user) const {
+    std::ofstream out(file);
+    if (!out.is_open() || foodIds.empty()) {
+        return false;
+    }
+    
+    std::mt19937 rng(config.seed + 1000 + static_cast<unsigned>(user));
+    TextWriter writer(&out);
+    for (const auto& date : getDates()) {
+        writer << date << ";";
+        size_t entryCount = 3 + rng() % 6;
+        for (size_t e = 0; e < entryCount; ++e) {
+            if (e > 0) writer << ",";
+            writer << foodIds[rng() % foodIds.size()] << ":" << 0.5 * (1 + rng() % 4);
+        }
+        writer << '\n';
+    }
+    writer.flush();
+    return true;
+}
+
+bool SyntheticData::writeProfile(const std::string& file, size_t user) const {
+    std::ofstream out(file);
+    if (!out.is_open()) {
+        return false;
+    }
+    
+    std::mt19937 rng(config.seed + 2000 + static_cast<unsigned>(user));
+    std::vector<std::string> dates = getDates();
+    TextWriter writer(&out);
+    writer << (user % 2 == 0 ? "Male" : "Female") << ";" << static_cast<int>(150 + rng() % 50) << ";"
+           << static_cast<int>(20 + rng() % 50) << ";Mifflin-St Jeor Equation\n";
+    
+    // Weekly weigh-ins and monthly activity changes
+    double weight = 60 + rng() % 40;
+    for (size_t i = 0; i < dates.size(); i += 7) {
+        if (i > 0) writer << ",";
+        weight += (static_cast<int>(rng() % 5) - 2) * 0.1;
+        writer << dates[i] << ":" << weight;
+    }
+    writer << "\n";
+    for (size_t i = 0; i < dates.size(); i += 30) {
+        if (i > 0) writer << ",";
+        writer << dates[i] << ":" << static_cast<int>(rng() % 5);
+    }
+    writer << "\n";
+    writer.flush();
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef SYNTHETIC_DATA_HPP
+#define SYNTHETIC_DATA_HPP
+
+#include <string>
+#include <vector>
+
+// Shape of the generated data set
+struct SyntheticConfig {
+    size_t foods;           // total foods in the database
+    size_t compositeDepth;  // composites nest up to this many levels
+    size_t years;           // years of daily logs per user
+    size_t users;           // independent log/profile pairs
+    unsigned seed;
+};
+
+// Deterministic generator for the files the app reads, so that benchmark
+// runs with the same config and seed measure identical inputs
+class SyntheticData {
+private:
+    SyntheticConfig config;
+    std::vector<std::string> foodIds;
+    std::vector<std::string> vocabulary;
+    
+public:
+    explicit SyntheticData(const SyntheticConfig& c);
+    
+    const SyntheticConfig& getConfig() const;
+    const std::vector<std::string>& getFoodIds() const;
+    const std::vector<std::string>& getVocabulary() const;
+    
+    // Dates from 2000-01-01, one per day for config.years years
+    std::vector<std::string> getDates() const;
+    
+    bool writeFoods(const std::string& file);
+    bool writeLog(const std::string& file, size_t user) const;
+    bool writeProfile(const std::string& file, size_t user) const;
+};
+
+#endif // SYNTHETIC_DATA_HPP
@@ -1,8 +1,104 @@
+#include "CommandLog.hpp"
 #include "DietManagerApp.hpp"
+#include "FoodImporter.hpp"
 #include "FoodTracker.hpp"
-int main() {
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: diet_assistant [--import FILE [--duplicates skip|replace]]\n";
+    return 2;
+}
+
+// Headless bulk import: load foods.txt, import the file, save, exit
+int importFoods(const std::string& path, DuplicatePolicy policy) {
+    // Unsaved actions are replayed on top of foods.txt; saving over it
+    // here would leave them replaying against the imported foods
+    CommandLog commandLog;
+    if (commandLog.hasUnsavedRecords()) {
+        std::cerr << "commands.log holds unsaved actions from the last session.\n"
+                  << "Start diet_assistant and save (option 6) before importing.\n";
+        return 1;
+    }
+
+    FoodDatabase* db = FoodDatabase::getInstance();
+    if (!db->loadDatabase()) {
+        std::cerr << "Could not open database file. Creating a new one.\n";
+    }
+    for (const std::string& error : db->getLoadErrors()) {
+        std::cerr << "Warning: " << error << ".\n";
+    }
+
+    FoodImporter importer(db);
+    importer.setDuplicatePolicy(policy);
+    importer.setProgressCallback([](const ImportProgress& progress) {
+        std::cerr << "\r" << progress.rowsRead << " rows";
+        if (progress.bytesTotal > 0) {
+            std::cerr << " (" << progress.bytesRead * 100 / progress.bytesTotal << "%)";
+        }
+        std::cerr.flush();
+    });
+
+    ImportProgress result;
+    bool ok = importer.importFile(path, result);
+    std::cerr << "\n";
+    for (const std::string& error : importer.getErrors()) {
+        std::cerr << error << "\n";
+    }
+    if (!ok) {
+        std::cerr << "Import failed, nothing was imported.\n";
+        return 1;
+    }
+
+    std::cout << "Rows read:  " << result.rowsRead << "\n"
+              << "Imported:   " << result.imported << "\n"
+              << "Replaced:   " << result.replaced << "\n"
+              << "Duplicates: " << result.duplicates << "\n"
+              << "Rejected:   " << result.rejected << "\n"
+              << "Time:       " << result.seconds << " s";
+    if (result.seconds > 0) {
+        std::cout << " (" << static_cast<size_t>(result.rowsRead / result.seconds) << " rows/s)";
+    }
+    std::cout << "\n";
+
+    if (result.imported + result.replaced > 0 && !db->saveDatabase()) {
+        std::cerr << "Could not open database file for writing.\n";
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        std::string path;
+        DuplicatePolicy policy = DuplicatePolicy::Skip;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--import") == 0 && i + 1 < argc) {
+                path = argv[++i];
+            } else if (std::strcmp(argv[i], "--duplicates") == 0 && i + 1 < argc) {
+                std::string value = argv[++i];
+                if (value == "replace") {
+                    policy = DuplicatePolicy::Replace;
+                } else if (value != "skip") {
+                    return usage();
+                }
+            } else {
+                return usage();
+            }
+        }
+        if (path.empty()) {
+            return usage();
+        }
+        return importFoods(path, policy);
+    }
+
     // displayDailySummary();
     DietManagerApp app;
     app.run();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,167 @@
+// Recovery from commands.log: a full replay, a torn or damaged tail, a
+// record that can no longer be applied and a log the snapshot already holds.
+#include "TestCheck.hpp"
+#include "Command.hpp"
+#include "CommandLog.hpp"
+
+namespace {
+    const char* DATE = "2024-01-01";
+
+    // What DietManagerApp holds, rebuilt from the files in the working
+    // directory like a fresh start of the program
+    struct Session {
+        DailyLog log;
+        DietProfile profile;
+        FoodUsageStats usage;
+        CommandLog commands;
+        UndoManager undoManager;
+        CommandContext context;
+
+        Session() : context{log, profile, FoodDatabase::getInstance(), &usage} {
+            FoodDatabase::getInstance()->loadDatabase();
+        }
+
+        int recover() {
+            int replayed = commands.replay(undoManager, context);
+            commands.open();
+            undoManager.setCommandLog(&commands);
+            return replayed;
+        }
+
+        bool add(const std::string& id, double servings) {
+            const Food* food = context.foodDb->getFood(id);
+            return food && undoManager.executeCommand(
+                std::make_shared<AddFoodCommand>(log, DATE, food, servings, &usage));
+        }
+
+        size_t entries() const {
+            const DayLog* day = log.findDayLog(DATE);
+            return day ? day->getEntries().size() : 0;
+        }
+
+        double calories() const {
+            const DayLog* day = log.findDayLog(DATE);
+            return day ? day->getTotalCalories() : 0.0;
+        }
+    };
+
+    void reset() {
+        test::writeFile("foods.txt", "BASIC;Apple;apple;95\nBASIC;Bread;bread;80\n");
+        test::removeFile("foods.txt.versions");
+        test::removeFile("commands.log");
+        test::removeFile("commands.log.snapshot");
+        test::removeFile("commands.log.rejected");
+    }
+
+    void testReplayRestoresSession() {
+        reset();
+        {
+            Session session;
+            CHECK(session.recover() == 0);
+            CHECK(session.add("Apple", 2));
+            CHECK(session.add("Bread", 1));
+            CHECK(session.add("Apple", 1));
+            CHECK(session.undoManager.undo());
+        }
+
+        Session session;
+        CHECK(session.commands.hasUnsavedRecords());
+        CHECK(session.recover() == 4);
+        CHECK(session.commands.getReplayError().empty());
+        CHECK(session.entries() == 2);
+        CHECK(session.calories() == 270);
+        CHECK(session.usage.getUseCount("Apple") == 1);
+
+        // Replayed commands can be undone like the originals
+        CHECK(session.undoManager.undo());
+        CHECK(session.calories() == 190);
+    }
+
+    void testTornTailIsDropped() {
+        reset();
+        size_t firstRecordEnd;
+        std::string full;
+        {
+            Session session;
+            session.recover();
+            CHECK(session.add("Apple", 1));
+            firstRecordEnd = test::readFile("commands.log").size();
+            CHECK(session.add("Bread", 1));
+            full = test::readFile("commands.log");
+        }
+        CHECK(full.size() > firstRecordEnd + 6);
+
+        // The second record was cut short by a crash
+        test::writeFile("commands.log", full.substr(0, firstRecordEnd + 6));
+        {
+            Session session;
+            CHECK(session.recover() == 1);
+            CHECK(session.commands.getReplayError().empty());
+            CHECK(session.entries() == 1);
+        }
+        CHECK(test::readFile("commands.log").size() == firstRecordEnd);
+        CHECK(test::readFile("commands.log.rejected").empty());
+
+        // A damaged length word claiming ~2 GiB is a torn tail too
+        test::writeFile("commands.log", full + std::string("\xff\xff\xff\x7f", 4));
+        {
+            Session session;
+            CHECK(session.recover() == 2);
+            CHECK(session.commands.getReplayError().empty());
+            CHECK(session.calories() == 175);
+        }
+        CHECK(test::readFile("commands.log") == full);
+    }
+
+    void testUnresolvableRecordStopsReplay() {
+        reset();
+        {
+            Session session;
+            session.recover();
+            CHECK(session.add("Apple", 1));
+            CHECK(session.add("Bread", 1));
+            CHECK(session.add("Apple", 1));
+        }
+
+        // Bread is gone from the snapshot, so its record and everything
+        // after it are set aside
+        test::writeFile("foods.txt", "BASIC;Apple;apple;95\n");
+        Session session;
+        CHECK(session.recover() == 1);
+        CHECK(!session.commands.getReplayError().empty());
+        CHECK(session.entries() == 1);
+        CHECK(!test::readFile("commands.log.rejected").empty());
+        // The record that was applied stays for the next start
+        CHECK(session.commands.hasUnsavedRecords());
+    }
+
+    void testSavedLogIsNotReplayed() {
+        reset();
+        std::string saved;
+        {
+            Session session;
+            session.recover();
+            CHECK(session.add("Apple", 1));
+            saved = test::readFile("commands.log");
+            CHECK(session.commands.checkpoint());
+            CHECK(!session.commands.hasUnsavedRecords());
+        }
+
+        // The program stopped between saving and clearing the log
+        test::writeFile("commands.log", saved);
+        CHECK(!Session().commands.hasUnsavedRecords());
+        Session session;
+        CHECK(session.recover() == 0);
+        CHECK(session.entries() == 0);
+    }
+}
+
+int main() {
+    testReplayRestoresSession();
+    testTornTailIsDropped();
+    testUnresolvableRecordStopsReplay();
+    testSavedLogIsNotReplayed();
+    reset();
+    test::removeFile("foods.txt");
+    return testResult();
+}
@@ -0,0 +1,131 @@
+// CSV/TSV parsing (quoting, line endings, rejected rows and their line
+// numbers across chunks) and what each duplicate policy does to versions.
+#include "TestCheck.hpp"
+#include "FoodImporter.hpp"
+#include <sstream>
+
+namespace {
+    FoodDatabase* db = FoodDatabase::getInstance();
+
+    bool import(const std::string& text, DuplicatePolicy policy, ImportProgress& result,
+                std::vector<std::string>* errors = nullptr, size_t chunkRows = FoodImporter::DEFAULT_CHUNK_ROWS) {
+        FoodImporter importer(db);
+        importer.setDuplicatePolicy(policy);
+        importer.setChunkRows(chunkRows);
+        std::istringstream in(text);
+        bool ok = importer.importStream(in, text.size(), result);
+        if (errors) {
+            *errors = importer.getErrors();
+        }
+        return ok;
+    }
+
+    void reset() {
+        test::writeFile("foods.txt", "BASIC;Apple;apple;95\nCOMPOSITE;Salad;salad;Apple:2\n");
+        test::removeFile("foods.txt.versions");
+        db->loadDatabase();
+    }
+
+    double nutrient(const std::string& id, Nutrient n) {
+        const Food* food = db->getFood(id);
+        return food ? food->getNutrientsPerServing().get(n) : -1.0;
+    }
+
+    void testCsvQuoting() {
+        reset();
+        const std::string csv =
+            "name,category,Calories (kcal),Protein (g)\n"
+            "\"Bread, Whole Wheat\",\"Bakery;Grain\",250,9\n"
+            "\"Say \"\"Cheese\"\"\",Dairy|Snack,400,25\n"
+            "Milk,,42,\r\n"
+            "\n"
+            "Bad,x,abc,1\n"
+            ",x,10,1\n"
+            "Short,x\n"
+            "Negative,x,-5,1\n"
+            "Water,Drink, 0 ,0\n";
+        ImportProgress result;
+        std::vector<std::string> errors;
+        // Two rows per chunk, so rows and line numbers cross chunk boundaries
+        CHECK(import(csv, DuplicatePolicy::Skip, result, &errors, 2));
+        CHECK(result.rowsRead == 8);
+        CHECK(result.imported == 4);
+        CHECK(result.rejected == 4);
+        CHECK(result.bytesRead == csv.size());
+
+        CHECK(nutrient("Bread Whole Wheat", Nutrient::Calories) == 250);
+        CHECK(nutrient("Bread Whole Wheat", Nutrient::Protein) == 9);
+        CHECK(db->getFood("Bread Whole Wheat")->getKeywords() == std::vector<std::string>({"Bakery", "Grain"}));
+        CHECK(nutrient("Say \"Cheese\"", Nutrient::Calories) == 400);
+        CHECK(db->getFood("Say \"Cheese\"")->getKeywords() == std::vector<std::string>({"Dairy", "Snack"}));
+        CHECK(nutrient("Milk", Nutrient::Calories) == 42);
+        CHECK(db->getFood("Milk")->getKeywords().empty());
+        CHECK(nutrient("Water", Nutrient::Calories) == 0);
+
+        CHECK(errors.size() == 4);
+        CHECK(errors.size() == 4 && errors[0] == "line 6: bad calories 'abc'");
+        CHECK(errors.size() == 4 && errors[1] == "line 7: missing identifier");
+        CHECK(errors.size() == 4 && errors[2].compare(0, 8, "line 8: ") == 0);
+        CHECK(errors.size() == 4 && errors[3] == "line 9: bad calories '-5'");
+    }
+
+    void testTsvAndHeaders() {
+        reset();
+        ImportProgress result;
+        CHECK(import("Food\tEnergy\tTotal Fat\n"
+                     "Pasta, cooked\t131\t1.1\n"
+                     "\"Tab\tName\"\t10\t\n",
+                     DuplicatePolicy::Skip, result));
+        CHECK(result.imported == 2);
+        CHECK(nutrient("Pasta cooked", Nutrient::Fat) == 1.1);
+        CHECK(nutrient("Tab Name", Nutrient::Calories) == 10);
+
+        // Without a calories column nothing is imported
+        std::vector<std::string> errors;
+        CHECK(!import("name,protein\nTofu,8\n", DuplicatePolicy::Skip, result, &errors));
+        CHECK(!db->getFood("Tofu"));
+        CHECK(errors.size() == 1);
+    }
+
+    void testDuplicatePolicies() {
+        reset();
+        const std::string apple = "name,keywords,calories\nApple,apple,100\n";
+        ImportProgress result;
+
+        CHECK(import(apple, DuplicatePolicy::Skip, result));
+        CHECK(result.duplicates == 1 && result.imported == 0 && result.replaced == 0);
+        CHECK(db->getFood("Apple")->getReference() == "Apple");
+        CHECK(nutrient("Apple", Nutrient::Calories) == 95);
+
+        // Replace publishes a new version, and composites follow it
+        CHECK(import(apple, DuplicatePolicy::Replace, result));
+        CHECK(result.replaced == 1 && result.duplicates == 0);
+        CHECK(db->getFood("Apple")->getReference() == "Apple@2");
+        CHECK(nutrient("Salad", Nutrient::Calories) == 200);
+        CHECK(db->resolveReference("Apple")->getCaloriesPerServing() == 95);
+
+        // Importing the same row again changes nothing and uses no version
+        CHECK(import(apple, DuplicatePolicy::Replace, result));
+        CHECK(result.duplicates == 1 && result.replaced == 0);
+        CHECK(db->getFood("Apple")->getReference() == "Apple@2");
+
+        // Repeated rows within one file: the first wins under Skip, the
+        // last under Replace
+        const std::string repeated = "name,calories\nPear,50\nPear,60\n";
+        CHECK(import(repeated, DuplicatePolicy::Skip, result));
+        CHECK(result.imported == 1 && result.duplicates == 1);
+        CHECK(nutrient("Pear", Nutrient::Calories) == 50);
+        db->removeFood("Pear", RemovePolicy::Block);
+        CHECK(import(repeated, DuplicatePolicy::Replace, result));
+        CHECK(result.imported == 1 && result.replaced == 1);
+        CHECK(nutrient("Pear", Nutrient::Calories) == 60);
+    }
+}
+
+int main() {
+    testCsvQuoting();
+    testTsvAndHeaders();
+    testDuplicatePolicies();
+    test::removeFile("foods.txt");
+    return testResult();
+}
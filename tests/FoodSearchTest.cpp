@@ -0,0 +1,187 @@
+// Typo-tolerant search and prefix completion over the term indexes,
+// checked against a brute-force scan of every live food's terms, after a
+// load and after single changes that update the indexes in place.
+#include "TestCheck.hpp"
+#include "FoodDatabase.hpp"
+#include "FuzzyIndex.hpp"
+#include "TextNormalizer.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+    FoodDatabase* db = FoodDatabase::getInstance();
+
+    const Food* basic(const std::string& id, const std::vector<std::string>& keywords, double calories) {
+        NutrientVector nutrients;
+        nutrients.set(Nutrient::Calories, calories);
+        return db->createBasicFood(id, keywords, nutrients);
+    }
+
+    // Folded identifier, its words and folded keywords, as the index has them
+    std::vector<std::string> termsOf(const Food* food) {
+        std::vector<std::string> terms;
+        std::string id = foldText(food->getIdentifier());
+        terms.push_back(id);
+        std::istringstream words(id);
+        std::string word;
+        while (words >> word) terms.push_back(word);
+        for (const auto& keyword : food->getKeywords()) {
+            terms.push_back(foldText(keyword));
+        }
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        return terms;
+    }
+
+    std::vector<SearchResult> referenceFuzzy(const std::vector<std::string>& keywords, bool matchAll) {
+        static const int DISTANCE_SCORES[] = {100, 60, 30};
+        std::vector<std::string> queries;
+        for (const auto& keyword : keywords) queries.push_back(foldText(keyword));
+        std::sort(queries.begin(), queries.end());
+        queries.erase(std::unique(queries.begin(), queries.end()), queries.end());
+
+        std::vector<SearchResult> results;
+        for (const Food* food : db->getAllFoods()) {
+            std::vector<std::string> terms = termsOf(food);
+            int score = 0;
+            size_t matched = 0;
+            for (const auto& query : queries) {
+                size_t radius = query.size() <= 2 ? 0 : (query.size() <= 5 ? 1 : 2);
+                int best = 0;
+                for (const auto& term : terms) {
+                    size_t distance = FuzzyIndex::editDistance(query, term);
+                    if (distance <= radius) best = std::max(best, DISTANCE_SCORES[distance]);
+                }
+                if (best > 0) {
+                    score += best;
+                    ++matched;
+                }
+            }
+            if (matched > 0 && (!matchAll || matched == queries.size())) {
+                results.push_back(SearchResult{food, score});
+            }
+        }
+        std::sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
+            return a.score != b.score ? a.score > b.score : a.food->getIdentifier() < b.food->getIdentifier();
+        });
+        return results;
+    }
+
+    bool sameResults(const std::vector<SearchResult>& a, const std::vector<SearchResult>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].food != b[i].food || a[i].score != b[i].score) return false;
+        }
+        return true;
+    }
+
+    // Each food once, under its first matching term in (term, identifier) order
+    std::vector<const Food*> referenceAutocomplete(const std::string& prefix, size_t limit) {
+        std::string folded = foldText(prefix);
+        std::vector<std::pair<std::string, const Food*>> termFoods;
+        for (const Food* food : db->getAllFoods()) {
+            for (const auto& term : termsOf(food)) {
+                if (!term.empty() && term.compare(0, folded.size(), folded) == 0) {
+                    termFoods.push_back(std::make_pair(term, food));
+                }
+            }
+        }
+        std::sort(termFoods.begin(), termFoods.end(),
+                  [](const std::pair<std::string, const Food*>& a, const std::pair<std::string, const Food*>& b) {
+                      return a.first != b.first ? a.first < b.first
+                                                : a.second->getIdentifier() < b.second->getIdentifier();
+                  });
+        std::vector<const Food*> completions;
+        for (const auto& termFood : termFoods) {
+            if (completions.size() == limit) break;
+            if (std::find(completions.begin(), completions.end(), termFood.second) == completions.end()) {
+                completions.push_back(termFood.second);
+            }
+        }
+        return completions;
+    }
+
+    void checkAutocomplete() {
+        const std::vector<std::string> prefixes = {"c", "ch", "chick", "Rí", "r", "gr", "kw1", "kw105", "z", ""};
+        for (const auto& prefix : prefixes) {
+            for (size_t limit : {1, 3, 100000}) {
+                CHECK(db->autocomplete(prefix, limit) == referenceAutocomplete(prefix, limit));
+            }
+        }
+    }
+
+    // Every query, all results at once and page by page
+    void checkFuzzyQueries() {
+        const std::vector<std::vector<std::string>> queries = {
+            {"chiken"}, {"rice"}, {"RICE"}, {"brwn", "rice"}, {"legum"}, {"ch"}, {"xyz"},
+            {"paper", "meat"}, {"curry"}, {"whte"}, {"chickpea"}, {"kw1050"}, {"kw10"}
+        };
+        for (const auto& query : queries) {
+            for (bool matchAll : {false, true}) {
+                std::vector<SearchResult> expected = referenceFuzzy(query, matchAll);
+                SearchPage all = db->fuzzySearch(query, matchAll, 100000);
+                CHECK(sameResults(all.results, expected));
+                CHECK(all.nextCursor.empty());
+
+                std::vector<SearchResult> paged;
+                std::string cursor;
+                do {
+                    SearchPage page = db->fuzzySearch(query, matchAll, 2, cursor);
+                    paged.insert(paged.end(), page.results.begin(), page.results.end());
+                    cursor = page.nextCursor;
+                } while (!cursor.empty());
+                CHECK(sameResults(paged, expected));
+            }
+        }
+    }
+
+    void testSearchAfterLoad() {
+        test::writeFile("foods.txt",
+                        "BASIC;Chicken;meat,poultry;200\n"
+                        "BASIC;Chickpea;legume;160\n"
+                        "BASIC;Kitchen Roll;paper;0\n"
+                        "BASIC;Rice;grain;130\n"
+                        "BASIC;Brown Rice;grain,whole;110\n");
+        test::removeFile("foods.txt.versions");
+        CHECK(db->loadDatabase());
+
+        SearchPage page = db->fuzzySearch({"chiken"}, false, 10);
+        CHECK(!page.results.empty() && page.results[0].food->getIdentifier() == "Chicken");
+        CHECK(!page.results.empty() && page.results[0].score == 60);
+        page = db->fuzzySearch({"brwn", "rice"}, true, 10);
+        CHECK(page.results.size() == 1 && page.results[0].food->getIdentifier() == "Brown Rice");
+        CHECK(db->fuzzySearch({"ch"}, false, 10).results.empty());
+        checkFuzzyQueries();
+
+        // Only identifiers start with "chick"
+        std::vector<const Food*> completions = db->autocomplete("chick", 10);
+        CHECK(completions.size() == 2 && completions[0]->getIdentifier() == "Chicken");
+        CHECK(db->autocomplete("zzz", 10).empty());
+        CHECK(db->autocomplete("r", 0).empty());
+        checkAutocomplete();
+    }
+
+    void testIndexFollowsChanges() {
+        // In place: a new food, an edit that drops and adds terms, a removal
+        CHECK(db->addFood(basic("Chicken Curry", {"curry", "spicy"}, 300)));
+        CHECK(db->updateFood(basic("Rice", {"grain", "white"}, 130)));
+        CHECK(db->removeFood("Chickpea", RemovePolicy::Block));
+        checkFuzzyQueries();
+        checkAutocomplete();
+
+        // More new terms than the overlay holds: the index is rebuilt
+        for (int i = 0; i < 1100; ++i) {
+            std::string n = std::to_string(i);
+            CHECK(db->addFood(basic("Food" + n, {"kw" + n}, i)));
+        }
+        checkFuzzyQueries();
+        checkAutocomplete();
+    }
+}
+
+int main() {
+    testSearchAfterLoad();
+    testIndexFollowsChanges();
+    test::removeFile("foods.txt");
+    return testResult();
+}
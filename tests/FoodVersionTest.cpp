@@ -0,0 +1,154 @@
+// Food versions stay put through edits, undo, command log replay and a
+// save and reload, so log entries keep the nutrients they recorded; and
+// loading copes with bare or unknown component references.
+#include "TestCheck.hpp"
+#include "Command.hpp"
+#include "CommandLog.hpp"
+
+namespace {
+    const char* DATE = "2024-01-01";
+    FoodDatabase* db = FoodDatabase::getInstance();
+
+    struct Session {
+        DailyLog log;
+        DietProfile profile;
+        FoodUsageStats usage;
+        CommandLog commands;
+        UndoManager undoManager;
+        CommandContext context;
+
+        Session() : context{log, profile, db, &usage} {
+            db->loadDatabase();
+            log.loadLog();
+            commands.replay(undoManager, context);
+            commands.open();
+            undoManager.setCommandLog(&commands);
+        }
+
+        bool add(const std::string& id, double servings) {
+            return undoManager.executeCommand(
+                std::make_shared<AddFoodCommand>(log, DATE, db->getFood(id), servings));
+        }
+
+        bool setCalories(const std::string& id, double calories) {
+            const Food* current = db->getFood(id);
+            NutrientVector nutrients = current->getNutrientsPerServing();
+            nutrients.set(Nutrient::Calories, calories);
+            const Food* replacement = db->createBasicFood(id, current->getKeywords(), nutrients);
+            return undoManager.executeCommand(std::make_shared<UpdateFoodCommand>(db, current, replacement));
+        }
+
+        bool save() {
+            return db->saveDatabase() && log.saveLog() && commands.checkpoint();
+        }
+
+        // "reference=calories" per entry of DATE
+        std::string entries() const {
+            std::string text;
+            const DayLog* day = log.findDayLog(DATE);
+            for (const LogEntry& entry : day ? day->getEntries() : std::vector<LogEntry>()) {
+                text += entry.food->getReference() + "=" + std::to_string(static_cast<int>(entry.getCalories())) + " ";
+            }
+            return text;
+        }
+    };
+
+    std::string liveReference(const std::string& id) {
+        const Food* food = db->getFood(id);
+        return food ? food->getReference() : "";
+    }
+
+    void reset() {
+        test::writeFile("foods.txt", "BASIC;Apple;apple;95\nCOMPOSITE;Salad;salad;Apple:2\n");
+        test::removeFile("foods.txt.versions");
+        test::removeFile("dailylog.txt");
+        test::removeFile("dailylog.txt.idx");
+        test::removeFile("commands.log");
+        test::removeFile("commands.log.snapshot");
+        test::removeFile("commands.log.rejected");
+    }
+
+    void testEditUndoReplayAndReload() {
+        reset();
+        std::string expectedEntries;
+        {
+            Session session;
+            CHECK(session.add("Salad", 1));
+            CHECK(session.setCalories("Apple", 100));
+            CHECK(liveReference("Apple") == "Apple@2");
+            CHECK(liveReference("Salad") == "Salad@2");
+            CHECK(session.add("Salad", 1));
+
+            // Undo brings the earlier versions back instead of copying them
+            CHECK(session.undoManager.undo());
+            CHECK(session.undoManager.undo());
+            CHECK(liveReference("Apple") == "Apple");
+            CHECK(liveReference("Salad") == "Salad");
+
+            // A new edit never reuses a version number
+            CHECK(session.setCalories("Apple", 110));
+            CHECK(liveReference("Apple") == "Apple@3");
+            CHECK(liveReference("Salad") == "Salad@3");
+            CHECK(session.add("Salad", 1));
+            expectedEntries = session.entries();
+            CHECK(expectedEntries == "Salad=190 Salad@3=220 ");
+        }
+        {
+            // Replayed on top of the unchanged foods.txt
+            Session session;
+            CHECK(session.commands.getReplayError().empty());
+            CHECK(liveReference("Apple") == "Apple@3");
+            CHECK(liveReference("Salad") == "Salad@3");
+            CHECK(session.entries() == expectedEntries);
+            CHECK(session.save());
+        }
+        {
+            // Saved and loaded again, with the old versions from foods.txt.versions
+            Session session;
+            CHECK(db->getLoadErrors().empty());
+            CHECK(liveReference("Apple") == "Apple@3");
+            CHECK(session.entries() == expectedEntries);
+            CHECK(db->resolveReference("Apple@2") && db->resolveReference("Apple@2")->getCaloriesPerServing() == 100);
+
+            // Undoing a replayed edit after the reload
+            CHECK(session.setCalories("Apple", 120));
+            CHECK(liveReference("Apple") == "Apple@4");
+            CHECK(session.undoManager.undo());
+            CHECK(liveReference("Apple") == "Apple@3");
+        }
+    }
+
+    void testLoadResolvesComponents() {
+        reset();
+        // A hand-edited file: bare names in live composites mean the live food
+        test::writeFile("foods.txt",
+                        "BASIC;Apple;apple;100\n"
+                        "COMPOSITE;Salad;salad;Apple:2\n"
+                        "COMPOSITE;Bowl;bowl;Apple@2:1,Pear:1\n");
+        test::writeFile("foods.txt.versions", "L;Apple;3\n");
+        CHECK(db->loadDatabase());
+        CHECK(db->getFood("Salad")->getCaloriesPerServing() == 200);
+
+        // Apple@2 is gone with the versions file (the live food stands in),
+        // Pear never existed; both are reported
+        CHECK(db->getFood("Bowl")->getCaloriesPerServing() == 100);
+        CHECK(db->getLoadErrors().size() == 2);
+
+        // Log entries and commands keep reading a bare name as version 1
+        CHECK(db->resolveReference("Apple") == nullptr);
+        CHECK(db->resolveReference("Apple@3") == db->getFood("Apple"));
+
+        // A line that fails to resolve does not use up a version number
+        CHECK(db->parseFood("COMPOSITE;Plate;plate;Pear:1") == nullptr);
+        const Food* plate = db->parseFood("COMPOSITE;Plate;plate;Apple@3:1");
+        CHECK(plate && plate->getVersion() == 1);
+        reset();
+    }
+}
+
+int main() {
+    testEditUndoReplayAndReload();
+    testLoadResolvesComponents();
+    test::removeFile("foods.txt");
+    return testResult();
+}
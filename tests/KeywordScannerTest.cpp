@@ -0,0 +1,81 @@
+// Every supported scan kernel against std::string::find, on edge cases and
+// on random vocabularies over a small alphabet (so hits are dense).
+#include "TestCheck.hpp"
+#include "KeywordScanner.hpp"
+#include <random>
+
+namespace {
+    std::vector<bool> referenceFind(const std::vector<std::string>& strings, const std::string& needle) {
+        std::vector<bool> mask;
+        for (const auto& text : strings) {
+            mask.push_back(text.find(needle) != std::string::npos);
+        }
+        return mask;
+    }
+
+    void checkKernels(const std::vector<std::string>& strings, const std::vector<std::string>& needles) {
+        KeywordScanner scanner;
+        for (const auto& text : strings) {
+            scanner.append(text);
+        }
+        CHECK(scanner.size() == strings.size());
+
+        std::vector<std::vector<bool>> expected;
+        for (const auto& needle : needles) {
+            expected.push_back(referenceFind(strings, needle));
+        }
+        for (ScanKernel kernel : {ScanKernel::Scalar, ScanKernel::Sse2, ScanKernel::Avx2}) {
+            CHECK(scanner.setKernel(kernel) == KeywordScanner::isSupported(kernel));
+            if (!KeywordScanner::isSupported(kernel)) {
+                continue;
+            }
+            CHECK(scanner.findContainingAll(needles) == expected);
+            for (size_t i = 0; i < needles.size(); ++i) {
+                CHECK(scanner.findContaining(needles[i]) == expected[i]);
+            }
+        }
+    }
+
+    void testEdgeCases() {
+        std::vector<std::string> strings = {
+            "", "a", "ab", "c", "abc", "banana", "bananas",
+            // Longer than a 32-byte block, with hits on either side of it
+            std::string(31, 'x') + "needle" + std::string(40, 'y') + "end",
+            "needle", "needl", "eedle", "nneedlee"
+        };
+        std::vector<std::string> needles = {
+            "", "a", "b", "ab", "bc", "ca", "ana", "nas", "needle", "end", "yend", "xxn",
+            "needles", std::string(80, 'y'), "z", "abc", "abc"
+        };
+        checkKernels(strings, needles);
+        checkKernels(std::vector<std::string>(), needles);
+        checkKernels(strings, std::vector<std::string>());
+    }
+
+    void testRandomVocabularies() {
+        std::mt19937 random(12345);
+        for (int round = 0; round < 50; ++round) {
+            std::uniform_int_distribution<int> letter(0, round % 2 == 0 ? 2 : 25);
+            std::uniform_int_distribution<size_t> stringLength(0, 70);
+            std::uniform_int_distribution<size_t> needleLength(1, 8);
+
+            std::vector<std::string> strings(1 + round * 7);
+            for (auto& text : strings) {
+                text.resize(stringLength(random));
+                for (char& c : text) c = static_cast<char>('a' + letter(random));
+            }
+            std::vector<std::string> needles(1 + round % 9);
+            for (auto& needle : needles) {
+                needle.resize(needleLength(random));
+                for (char& c : needle) c = static_cast<char>('a' + letter(random));
+            }
+            checkKernels(strings, needles);
+        }
+    }
+}
+
+int main() {
+    testEdgeCases();
+    testRandomVocabularies();
+    return testResult();
+}
@@ -0,0 +1,54 @@
+// Minimal checks for the test executables: a failed CHECK prints where it
+// failed and carries on, and main() returns testResult() for ctest.
+#ifndef TEST_CHECK_HPP
+#define TEST_CHECK_HPP
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+namespace test {
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void fail(const char* file, int line, const char* expression) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+        ++failures();
+    }
+
+    // Tests run in their own directory (see CMakeLists.txt); the data files
+    // are written there and removed again
+    inline void writeFile(const std::string& path, const std::string& contents) {
+        std::ofstream(path, std::ios::binary) << contents;
+    }
+
+    inline std::string readFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    inline void removeFile(const std::string& path) {
+        std::remove(path.c_str());
+    }
+}
+
+#define CHECK(expression) \
+    do { \
+        if (!(expression)) { \
+            test::fail(__FILE__, __LINE__, #expression); \
+        } \
+    } while (0)
+
+inline int testResult() {
+    if (test::failures() > 0) {
+        std::cerr << test::failures() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif // TEST_CHECK_HPP